@@ -0,0 +1,208 @@
+#include "srpch.h"
+
+#include "Core/Timer.h"
+#include "Renderer/CoverageKernel.h"
+
+#include <glm/glm.hpp>
+
+#include <random>
+
+using namespace SvgRenderer;
+
+static constexpr uint32_t TILE_COUNT = 4096;
+static constexpr uint32_t ITERATIONS = 20;
+static constexpr uint32_t TILE_PIXELS = TILE_SIZE * TILE_SIZE;
+
+// Scalar path of AccumulateCoverage written out plainly, the kernel has to match it exactly in every build
+static void AccumulateReference(const Increment* increments, int32_t* carry, uint32_t fillRule, uint8_t* dst)
+{
+	for (uint32_t y = 0; y < TILE_SIZE; y++)
+	{
+		int32_t accum = carry[y];
+		for (uint32_t x = 0; x < TILE_SIZE; x++)
+		{
+			const Increment& increment = increments[y * TILE_SIZE + x];
+			float winding = glm::abs(static_cast<float>(accum + increment.area)) * (1.0f / 1000.0f);
+			if (fillRule == FILL_RULE_EVENODD)
+			{
+				winding = 1.0f - glm::abs(glm::fract(winding * 0.5f) * 2.0f - 1.0f);
+			}
+
+			dst[y * TILE_SIZE + x] = static_cast<uint8_t>(glm::min(winding * 256.0f, 255.0f));
+			accum += increment.height;
+		}
+
+		carry[y] = accum;
+	}
+}
+
+// Rasterizer::Fine before AccumulateCoverage, the increments converted to float areas and heights per pixel
+static void AccumulateFloat(const Increment* increments, float* carry, uint8_t* dst)
+{
+	std::array<float, TILE_PIXELS> areas;
+	std::array<float, TILE_PIXELS> heights;
+	for (uint32_t i = 0; i < TILE_PIXELS; i++)
+	{
+		areas[i] = increments[i].area / 1000.0f;
+		heights[i] = increments[i].height / 1000.0f;
+	}
+
+	for (uint32_t y = 0; y < TILE_SIZE; y++)
+	{
+		float accum = carry[y];
+		for (uint32_t x = 0; x < TILE_SIZE; x++)
+		{
+			dst[y * TILE_SIZE + x] = glm::min(glm::abs(accum + areas[y * TILE_SIZE + x]) * 256.0f, 255.0f);
+			accum += heights[y * TILE_SIZE + x];
+		}
+
+		carry[y] = accum;
+	}
+}
+
+// Increments of a pixel stay within one pixel, so the area and the height are at most 1000 either way.
+// Most pixels of a tile are not crossed by any line, those are zero
+static std::vector<Increment> GenerateTiles(uint32_t tileCount, std::mt19937& random)
+{
+	std::uniform_int_distribution<int32_t> value(-1000, 1000);
+	std::uniform_int_distribution<uint32_t> crossed(0, 3);
+
+	std::vector<Increment> increments(tileCount * TILE_PIXELS, Increment{ 0, 0 });
+	for (Increment& increment : increments)
+	{
+		if (crossed(random) == 0)
+		{
+			increment = Increment{ value(random), value(random) };
+		}
+	}
+
+	return increments;
+}
+
+// The carry is up to a few windings, so the even-odd folding sees every parity
+static std::vector<int32_t> GenerateCarries(uint32_t tileCount, std::mt19937& random)
+{
+	std::uniform_int_distribution<int32_t> value(-4000, 4000);
+
+	std::vector<int32_t> carries(tileCount * TILE_SIZE);
+	for (int32_t& carry : carries)
+	{
+		carry = value(random);
+	}
+
+	return carries;
+}
+
+static bool Check(const std::vector<Increment>& increments, const std::vector<int32_t>& carries, uint32_t fillRule)
+{
+	const uint32_t tileCount = carries.size() / TILE_SIZE;
+	for (uint32_t tile = 0; tile < tileCount; tile++)
+	{
+		std::array<int32_t, TILE_SIZE> expectedCarry;
+		std::array<int32_t, TILE_SIZE> actualCarry;
+		std::copy_n(carries.data() + tile * TILE_SIZE, TILE_SIZE, expectedCarry.begin());
+		std::copy_n(carries.data() + tile * TILE_SIZE, TILE_SIZE, actualCarry.begin());
+
+		// The kernel gets a stride wider than the tile, like the atlas, the pixels in between have to stay untouched
+		constexpr size_t stride = TILE_SIZE + 7;
+		std::array<uint8_t, TILE_PIXELS> expected;
+		std::array<uint8_t, TILE_SIZE * stride> actual;
+		std::fill(actual.begin(), actual.end(), 0xCD);
+
+		AccumulateReference(increments.data() + tile * TILE_PIXELS, expectedCarry.data(), fillRule, expected.data());
+		AccumulateCoverage(increments.data() + tile * TILE_PIXELS, actualCarry.data(), fillRule, actual.data(), stride);
+
+		for (uint32_t y = 0; y < TILE_SIZE; y++)
+		{
+			if (actualCarry[y] != expectedCarry[y])
+			{
+				SR_ERROR("Carry of row {0} of tile {1} is {2}, expected {3}", y, tile, actualCarry[y], expectedCarry[y]);
+				return false;
+			}
+
+			for (uint32_t x = 0; x < stride; x++)
+			{
+				const uint8_t value = actual[y * stride + x];
+				const uint8_t expectedValue = x < TILE_SIZE ? expected[y * TILE_SIZE + x] : 0xCD;
+				if (value != expectedValue)
+				{
+					SR_ERROR("Pixel ({0}, {1}) of tile {2} is {3}, expected {4}", x, y, tile, static_cast<uint32_t>(value), static_cast<uint32_t>(expectedValue));
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+static const char* GetVariantName()
+{
+#if defined(SR_DISABLE_SIMD)
+	return "scalar";
+#elif defined(__AVX2__)
+	return "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	return "SSE2";
+#elif defined(__ARM_NEON)
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+
+template<typename Func>
+static float Measure(Func&& func)
+{
+	func(); // Warm up
+	Timer timer;
+	for (uint32_t i = 0; i < ITERATIONS; i++)
+	{
+		func();
+	}
+	return timer.ElapsedMillis() / ITERATIONS;
+}
+
+int main()
+{
+	Log::Init();
+
+	std::mt19937 random(1234);
+	const std::vector<Increment> increments = GenerateTiles(TILE_COUNT, random);
+	const std::vector<int32_t> carries = GenerateCarries(TILE_COUNT, random);
+
+	if (!Check(increments, carries, FILL_RULE_NONZERO) || !Check(increments, carries, FILL_RULE_EVENODD))
+	{
+		SR_ERROR("AccumulateCoverage ({0}) does not match the scalar path", GetVariantName());
+		return 1;
+	}
+
+	// The tiles of a path in a row share the carry, like in Rasterizer::Fine
+	std::vector<uint8_t> coverage(TILE_COUNT * TILE_PIXELS);
+	std::array<int32_t, TILE_SIZE> carry{};
+	std::array<float, TILE_SIZE> floatCarry{};
+	const auto runKernel = [&](uint32_t fillRule)
+	{
+		for (uint32_t tile = 0; tile < TILE_COUNT; tile++)
+		{
+			AccumulateCoverage(increments.data() + tile * TILE_PIXELS, carry.data(), fillRule, coverage.data() + tile * TILE_PIXELS, TILE_SIZE);
+		}
+	};
+
+	const float floatMs = Measure([&]()
+	{
+		for (uint32_t tile = 0; tile < TILE_COUNT; tile++)
+		{
+			AccumulateFloat(increments.data() + tile * TILE_PIXELS, floatCarry.data(), coverage.data() + tile * TILE_PIXELS);
+		}
+	});
+	const float nonZeroMs = Measure([&]() { runKernel(FILL_RULE_NONZERO); });
+	const float evenOddMs = Measure([&]() { runKernel(FILL_RULE_EVENODD); });
+
+	SR_INFO("{0} random tiles", TILE_COUNT);
+	SR_INFO("Float per-pixel (nonzero): {0} ms ({1} Mtiles/s)", floatMs, TILE_COUNT / floatMs / 1000.0f);
+	SR_INFO("AccumulateCoverage ({0}) nonzero: {1} ms ({2} Mtiles/s), {3}x", GetVariantName(), nonZeroMs, TILE_COUNT / nonZeroMs / 1000.0f, floatMs / nonZeroMs);
+	SR_INFO("AccumulateCoverage ({0}) evenodd: {1} ms ({2} Mtiles/s)", GetVariantName(), evenOddMs, TILE_COUNT / evenOddMs / 1000.0f);
+
+	return 0;
+}
@@ -0,0 +1,217 @@
+#include "srpch.h"
+
+#include "Core/SvgParser.h"
+#include "Core/Timer.h"
+#include "Renderer/PointTransform.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+using namespace SvgRenderer;
+
+static constexpr uint32_t ITERATIONS = 20;
+
+// Points of every path of the document in document order, with the points of path i in [offsets[i], offsets[i + 1])
+struct PointStream
+{
+	std::vector<glm::vec2> points;
+	std::vector<uint32_t> offsets;
+	std::vector<glm::mat4> transforms;
+};
+
+static bool LoadPointStream(const std::filesystem::path& path, PointStream& stream)
+{
+	SvgDocument document;
+	if (!SvgParser::Scan(path, document))
+	{
+		return false;
+	}
+
+	SvgPath svgPath;
+	for (const SvgPathSource& source : document.paths)
+	{
+		SvgParser::ParsePath(source, svgPath);
+
+		stream.offsets.push_back(stream.points.size());
+		stream.transforms.push_back(glm::mat4(source.transform));
+		for (const SvgPath::Segment& segment : svgPath.segments)
+		{
+			switch (segment.type)
+			{
+			case SvgPath::Segment::Type::MoveTo:
+				stream.points.push_back(segment.as.moveTo.p);
+				break;
+			case SvgPath::Segment::Type::LineTo:
+				stream.points.push_back(segment.as.lineTo.p);
+				break;
+			case SvgPath::Segment::Type::QuadTo:
+				stream.points.push_back(segment.as.quadTo.p1);
+				stream.points.push_back(segment.as.quadTo.p2);
+				break;
+			case SvgPath::Segment::Type::CubicTo:
+				stream.points.push_back(segment.as.cubicTo.p1);
+				stream.points.push_back(segment.as.cubicTo.p2);
+				stream.points.push_back(segment.as.cubicTo.p3);
+				break;
+			case SvgPath::Segment::Type::Close:
+				break;
+			}
+		}
+	}
+
+	stream.offsets.push_back(stream.points.size());
+	return true;
+}
+
+// Same as the CPU pipeline did before TransformPoints, one matrix product per point
+static void TransformScalar(const PointStream& stream, const glm::mat4& globalTransform, std::vector<glm::vec2>& dst)
+{
+	for (size_t i = 0; i < stream.transforms.size(); i++)
+	{
+		const glm::mat4& transform = stream.transforms[i];
+		for (uint32_t p = stream.offsets[i]; p < stream.offsets[i + 1]; p++)
+		{
+			dst[p] = globalTransform * (transform * glm::vec4(stream.points[p], 1.0f, 1.0f));
+		}
+	}
+}
+
+static void TransformBatched(const PointStream& stream, const glm::mat4& globalTransform, std::vector<glm::vec2>& dst)
+{
+	for (size_t i = 0; i < stream.transforms.size(); i++)
+	{
+		const AffineTransform transform = AffineTransform::FromMat4(globalTransform * stream.transforms[i]);
+		const uint32_t start = stream.offsets[i];
+		TransformPoints(transform, stream.points.data() + start, dst.data() + start, stream.offsets[i + 1] - start);
+	}
+}
+
+// The two paths round differently, FMA on AVX2 and the order of the products
+static bool IsClose(const glm::vec2& a, const glm::vec2& b)
+{
+	const float tolerance = 1e-4f * (1.0f + std::max(std::abs(a.x), std::abs(a.y)));
+	return std::abs(a.x - b.x) <= tolerance && std::abs(a.y - b.y) <= tolerance;
+}
+
+static bool CheckStream(const PointStream& stream, const glm::mat4& globalTransform)
+{
+	std::vector<glm::vec2> expected(stream.points.size());
+	std::vector<glm::vec2> actual(stream.points.size());
+	TransformScalar(stream, globalTransform, expected);
+	TransformBatched(stream, globalTransform, actual);
+
+	for (size_t i = 0; i < expected.size(); i++)
+	{
+		if (!IsClose(expected[i], actual[i]))
+		{
+			SR_ERROR("Point {0} is ({1}, {2}), expected ({3}, {4})", i, actual[i].x, actual[i].y, expected[i].x, expected[i].y);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Every count up to a few vector widths, from unaligned starts and in place, so the scalar tail runs with every length
+static bool CheckTail(const glm::mat4& globalTransform)
+{
+	const AffineTransform transform = AffineTransform::FromMat4(globalTransform);
+
+	std::vector<glm::vec2> src(64);
+	for (size_t i = 0; i < src.size(); i++)
+	{
+		src[i] = glm::vec2(i * 3.25f - 40.0f, 17.5f - i * 1.75f);
+	}
+
+	for (uint32_t start = 0; start < 3; start++)
+	{
+		for (uint32_t count = 0; count <= 33; count++)
+		{
+			std::vector<glm::vec2> dst(src.size(), glm::vec2(-1.0f));
+			TransformPoints(transform, src.data() + start, dst.data() + start, count);
+
+			std::vector<glm::vec2> inPlace = src;
+			TransformPoints(transform, inPlace.data() + start, inPlace.data() + start, count);
+
+			for (uint32_t i = 0; i < src.size(); i++)
+			{
+				const bool isInside = i >= start && i < start + count;
+				const glm::vec2 expected = isInside ? transform.Apply(src[i]) : glm::vec2(-1.0f);
+				if (!IsClose(dst[i], expected) || !IsClose(inPlace[i], isInside ? expected : src[i]))
+				{
+					SR_ERROR("Point {0} of {1} points starting at {2} does not match", i, count, start);
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+static const char* GetVariantName()
+{
+#if defined(SR_DISABLE_SIMD)
+	return "scalar";
+#elif defined(__AVX2__)
+	return "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	return "SSE2";
+#elif defined(__ARM_NEON)
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+
+template<typename Func>
+static float Measure(Func&& func)
+{
+	func(); // Warm up
+	Timer timer;
+	for (uint32_t i = 0; i < ITERATIONS; i++)
+	{
+		func();
+	}
+	return timer.ElapsedMillis() / ITERATIONS;
+}
+
+int main(int argc, char** argv)
+{
+	Log::Init();
+
+	const std::filesystem::path svgPath = argc > 1 ? std::filesystem::path(argv[1]) : std::filesystem::path(SR_ASSETS_PATH) / "svgs" / "world.svg";
+
+	PointStream stream;
+	if (!LoadPointStream(svgPath, stream))
+	{
+		SR_ERROR("Failed to load {0}", svgPath.string());
+		return 1;
+	}
+
+	// Scale and translation like the viewport would add, so every coefficient of the transform is used
+	glm::mat4 globalTransform(1.0f);
+	globalTransform[0][0] = 1.5f;
+	globalTransform[1][1] = 1.5f;
+	globalTransform[1][0] = 0.25f;
+	globalTransform[3][0] = -120.0f;
+	globalTransform[3][1] = 35.0f;
+
+	if (!CheckTail(globalTransform) || !CheckStream(stream, globalTransform))
+	{
+		SR_ERROR("TransformPoints ({0}) does not match the scalar path", GetVariantName());
+		return 1;
+	}
+
+	std::vector<glm::vec2> dst(stream.points.size());
+	const float scalarMs = Measure([&]() { TransformScalar(stream, globalTransform, dst); });
+	const float batchedMs = Measure([&]() { TransformBatched(stream, globalTransform, dst); });
+
+	const float pointCount = static_cast<float>(stream.points.size());
+	SR_INFO("{0}: {1} paths, {2} points", svgPath.filename().string(), stream.transforms.size(), stream.points.size());
+	SR_INFO("Per-point mat4: {0} ms ({1} Mpoints/s)", scalarMs, pointCount / scalarMs / 1000.0f);
+	SR_INFO("TransformPoints ({0}): {1} ms ({2} Mpoints/s), {3}x", GetVariantName(), batchedMs, pointCount / batchedMs / 1000.0f, scalarMs / batchedMs);
+
+	return 0;
+}
@@ -34,9 +34,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <array>
+#include <cstdlib>
 #include <vector>
-#include <execution>
-#include <future>
 
 namespace SvgRenderer {
 
@@ -233,12 +232,25 @@ namespace SvgRenderer {
 		cmds.push_back(PathCmd(LineToCmd{ .p1 = p1 }));
 	}
 
-	static void AddFillPath(const SvgPath& path)
+	// Commands of a single path, built in parallel with the other paths and then copied into the scene
+	struct FillCommands
+	{
+		std::vector<uint8_t> types;
+		std::vector<glm::vec2> points;
+
+		void Add(uint32_t type, const glm::vec2* cmdPoints)
+		{
+			types.push_back(static_cast<uint8_t>(type));
+			points.insert(points.end(), cmdPoints, cmdPoints + GetCmdPointCount(type));
+		}
+	};
+
+	static void BuildFillCommands(const SvgPath& path, FillCommands& cmds)
 	{
 		glm::vec2 first = { 0, 0 };
 		glm::vec2 last = { 0, 0 };
 
-		std::vector<PathCmd> cmds;
+		// Points of the segments are stored one after another, the same way as the commands expect them
 		for (const SvgPath::Segment& seg : path.segments)
 		{
 			switch (seg.type)
@@ -247,10 +259,10 @@ namespace SvgRenderer {
 			{
 				if (last != first)
 				{
-					cmds.push_back(PathCmd(LineToCmd{ .p1 = first }));
+					cmds.Add(LINE_TO, &first);
 				}
 
-				cmds.push_back(PathCmd(MoveToCmd{ .point = seg.as.moveTo.p }));
+				cmds.Add(MOVE_TO, &seg.as.moveTo.p);
 				first = seg.as.moveTo.p;
 				last = seg.as.moveTo.p;
 				break;
@@ -258,7 +270,7 @@ namespace SvgRenderer {
 			case SvgPath::Segment::Type::LineTo:
 				if (seg.as.lineTo.p != last)
 				{
-					cmds.push_back(PathCmd(LineToCmd{ .p1 = seg.as.lineTo.p }));
+					cmds.Add(LINE_TO, &seg.as.lineTo.p);
 				}
 
 				last = seg.as.lineTo.p;
@@ -266,17 +278,17 @@ namespace SvgRenderer {
 			case SvgPath::Segment::Type::Close:
 				if (first != last)
 				{
-					cmds.push_back(LineToCmd{ .p1 = first });
+					cmds.Add(LINE_TO, &first);
 				}
 
 				last = first;
 				break;
 			case SvgPath::Segment::Type::QuadTo:
-				cmds.push_back(PathCmd(QuadToCmd{ .p1 = seg.as.quadTo.p1, .p2 = seg.as.quadTo.p2 }));
+				cmds.Add(QUAD_TO, &seg.as.quadTo.p1);
 				last = seg.as.quadTo.p2;
 				break;
 			case SvgPath::Segment::Type::CubicTo:
-				cmds.push_back(PathCmd(CubicToCmd{ .p1 = seg.as.cubicTo.p1, .p2 = seg.as.cubicTo.p2, .p3 = seg.as.cubicTo.p3 }));
+				cmds.Add(CUBIC_TO, &seg.as.cubicTo.p1);
 				last = seg.as.cubicTo.p3;
 				break;
 			// TODO: Implement others
@@ -286,38 +298,72 @@ namespace SvgRenderer {
 		// Only for FILL, not for STROKE
 		if (last != first)
 		{
-			cmds.push_back(PathCmd(LineToCmd{ .p1 = first }));
+			cmds.Add(LINE_TO, &first);
 		}
+	}
 
-		const SvgColor& fillColor = path.fill.color;
-		std::array<uint8_t, 4> color = { fillColor.r, fillColor.g, fillColor.b, static_cast<uint8_t>(path.fill.opacity * 255.0f) };
-
-		Globals::AllPaths.paths.push_back(PathRender{
-			.startCmdIndex = static_cast<uint32_t>(Globals::AllPaths.commands.size()),
-			.endCmdIndex = static_cast<uint32_t>(Globals::AllPaths.commands.size() + cmds.size() - 1),
-			.transform = path.transform,
-			.bbox = BoundingBox(),
-			.color = color
-			});
+	// Places the commands of the paths into the scene in document order, paths without any command are dropped
+	static void AddFillPaths(const SvgDocument& document, std::vector<FillCommands>& fillCommands, TaskScheduler& scheduler)
+	{
+		const uint32_t count = static_cast<uint32_t>(fillCommands.size());
 
-		for (const PathCmd& cmd : cmds)
+		// Exclusive prefix sums of the paths, commands and points, the last element is the total
+		std::vector<uint32_t> pathOffsets(count + 1, 0);
+		std::vector<uint32_t> cmdOffsets(count + 1, 0);
+		std::vector<uint32_t> pointOffsets(count + 1, 0);
+		for (uint32_t i = 0; i < count; i++)
 		{
-			uint32_t index = Globals::AllPaths.paths.size() - 1; // -1, since we added path in the previous lines
-			uint32_t pathIndexCmdType = MAKE_CMD_PATH_INDEX(0, index);
-			pathIndexCmdType = MAKE_CMD_TYPE(pathIndexCmdType, static_cast<uint32_t>(cmd.type));
-
-			// This is just to fill all the 3 points, even though not all may be used
-			// It is based on the cmd type
-			std::array<glm::vec2, 4> points; // We use only 3 of 4, it is just for padding
-			points[0] = cmd.as.cubicTo.p1;
-			points[1] = cmd.as.cubicTo.p2;
-			points[2] = cmd.as.cubicTo.p3;
-
-			Globals::AllPaths.commands.push_back(PathRenderCmd{
-				.pathIndexCmdType = pathIndexCmdType,
-				.points = points
-				});
+			const FillCommands& cmds = fillCommands[i];
+			pathOffsets[i + 1] = pathOffsets[i] + (cmds.types.empty() ? 0 : 1);
+			cmdOffsets[i + 1] = cmdOffsets[i] + static_cast<uint32_t>(cmds.types.size());
+			pointOffsets[i + 1] = pointOffsets[i] + static_cast<uint32_t>(cmds.points.size());
 		}
+
+		std::vector<PathRender>& paths = Globals::AllPaths.paths;
+		CommandsContainer& commands = Globals::AllPaths.commands;
+
+		const uint32_t firstPath = static_cast<uint32_t>(paths.size());
+		const uint32_t firstCmd = commands.Size();
+		const uint32_t firstPoint = static_cast<uint32_t>(commands.points.size());
+
+		paths.resize(firstPath + pathOffsets[count]);
+		commands.Resize(firstCmd + cmdOffsets[count], firstPoint + pointOffsets[count]);
+
+		scheduler.ParallelFor(0, count, [&](uint32_t i)
+		{
+			FillCommands& cmds = fillCommands[i];
+			if (cmds.types.empty())
+			{
+				return;
+			}
+
+			const uint32_t pathIndex = firstPath + pathOffsets[i];
+			const uint32_t cmdIndex = firstCmd + cmdOffsets[i];
+			uint32_t pointIndex = firstPoint + pointOffsets[i];
+
+			const SvgPathSource& source = document.paths[i];
+			const SvgColor& fillColor = source.fill.color;
+			paths[pathIndex] = PathRender{
+				.startCmdIndex = cmdIndex,
+				.endCmdIndex = cmdIndex + static_cast<uint32_t>(cmds.types.size()) - 1,
+				.transform = source.transform,
+				.bbox = BoundingBox(),
+				.color = { fillColor.r, fillColor.g, fillColor.b, static_cast<uint8_t>(source.fill.opacity * 255.0f) },
+				.fillRule = source.fill.fillRule == SvgFillRule::EvenOdd ? FILL_RULE_EVENODD : FILL_RULE_NONZERO
+			};
+
+			std::copy(cmds.types.begin(), cmds.types.end(), commands.types.begin() + cmdIndex);
+			std::fill_n(commands.pathIndices.begin() + cmdIndex, cmds.types.size(), pathIndex);
+			std::copy(cmds.points.begin(), cmds.points.end(), commands.points.begin() + pointIndex);
+			for (uint32_t j = 0; j < cmds.types.size(); j++)
+			{
+				pointIndex += GetCmdPointCount(cmds.types[j]);
+				commands.pointsOffsets[cmdIndex + j + 1] = pointIndex;
+			}
+
+			// The buffer is not needed anymore, release it right away to keep the peak memory down
+			cmds = FillCommands();
+		});
 	}
 
 	static void AddStrokePath(const SvgPath& path)
@@ -367,92 +413,34 @@ namespace SvgRenderer {
 		std::array<uint8_t, 4> color = { fillColor.r, fillColor.g, fillColor.b, static_cast<uint8_t>(path.fill.opacity * 255.0f) };
 
 		Globals::AllPaths.paths.push_back(PathRender{
-			.startCmdIndex = static_cast<uint32_t>(Globals::AllPaths.commands.size()),
-			.endCmdIndex = static_cast<uint32_t>(Globals::AllPaths.commands.size() + cmds.size() - 1),
+			.startCmdIndex = static_cast<uint32_t>(Globals::AllPaths.commands.Size()),
+			.endCmdIndex = static_cast<uint32_t>(Globals::AllPaths.commands.Size() + cmds.size() - 1),
 			.transform = path.transform,
 			.bbox = BoundingBox(),
 			.color = color
 		});
 
+		const uint32_t pathIndex = static_cast<uint32_t>(Globals::AllPaths.paths.size() - 1); // -1, since we added path in the previous lines
 		for (const PathCmd& cmd : cmds)
 		{
-			uint32_t index = Globals::AllPaths.paths.size() - 1; // -1, since we added path in the previous lines
-			uint32_t pathIndexCmdType = MAKE_CMD_PATH_INDEX(0, index);
-			pathIndexCmdType = MAKE_CMD_TYPE(pathIndexCmdType, static_cast<uint32_t>(cmd.type));
-
-			// This is just to fill all the 3 points, even though not all may be used
-			// It is based on the cmd type
-			std::array<glm::vec2, 4> points; // We use only 3 of 4 (padding)
-			points[0] = cmd.as.cubicTo.p1;
-			points[1] = cmd.as.cubicTo.p2;
-			points[2] = cmd.as.cubicTo.p3;
-
-			Globals::AllPaths.commands.push_back(PathRenderCmd{
-				.pathIndexCmdType = pathIndexCmdType,
-				.points = points
-			});
-		}
-	}
-
-	static void ProcessSvgNode(const SvgNode* node)
-	{
-		switch (node->type)
-		{
-		case SvgNodeType::Path:
-		{
-			const SvgPath& path = node->as.path;
-			AddFillPath(path);
-			if (path.stroke.hasStroke)
-			{
-				//AddStrokePath(path, builder);
-			}
-
-			break;
+			// Points of all the command types are at the start of the union, only the used ones are stored
+			const glm::vec2 points[3] = { cmd.as.cubicTo.p1, cmd.as.cubicTo.p2, cmd.as.cubicTo.p3 };
+			Globals::AllPaths.commands.Add(static_cast<uint32_t>(cmd.type), pathIndex, points);
 		}
-		}
-
-		for (const SvgNode* child : node->children)
-		{
-			ProcessSvgNode(child);
-		}
-	}
-
-	static glm::vec2 ApplyTransform(const glm::mat4& transform, const glm::vec2& point)
-	{
-		return Globals::GlobalTransform * transform * glm::vec4(point, 1.0f, 1.0f);
 	}
 
-	static void TransformCurve(PathRenderCmd* cmd)
+	// SR_GPU_PROFILE=1 times every stage of the GPU pipeline, it costs a query per stage, so it is off by default
+	static bool IsGPUProfilingEnabled()
 	{
-		uint32_t pathIndex = GET_CMD_PATH_INDEX(cmd->pathIndexCmdType);
-		cmd->transformedPoints[0] = ApplyTransform(Globals::AllPaths.paths[pathIndex].transform, cmd->points[0]);
-		cmd->transformedPoints[1] = ApplyTransform(Globals::AllPaths.paths[pathIndex].transform, cmd->points[1]);
-		cmd->transformedPoints[2] = ApplyTransform(Globals::AllPaths.paths[pathIndex].transform, cmd->points[2]);
+		const char* profile = std::getenv("SR_GPU_PROFILE");
+		return profile != nullptr && std::string(profile) == "1";
 	}
 
-	static glm::vec2 GetPreviousPoint(const PathRender& path, uint32_t index)
+	void Application::Init(const std::filesystem::path& svgFilepath, FramePacing framePacing)
 	{
-		if (index == path.startCmdIndex)
-		{
-			return glm::vec2(0, 0);
-		}
-
-		PathRenderCmd& prevCmd = Globals::AllPaths.commands[index - 1];
-		uint32_t pathType = GET_CMD_TYPE(prevCmd.pathIndexCmdType);
-		switch (pathType)
-		{
-		case MOVE_TO:
-		case LINE_TO:
-			return prevCmd.transformedPoints[0];
-		case QUAD_TO:
-			return prevCmd.transformedPoints[1];
-		case CUBIC_TO:
-			return prevCmd.transformedPoints[2];
-		}
-	}
+		m_FramePacing = framePacing;
+		m_Scheduler.Init(TaskSchedulerConfig::FromEnvironment());
 
-	void Application::Init(const std::filesystem::path& svgFilepath)
-	{
 		m_Window = Window::Create({
 			.width = Globals::WindowWidth,
 			.height = Globals::WindowHeight,
@@ -477,22 +465,111 @@ namespace SvgRenderer {
 
 		Renderer::Init(Globals::WindowWidth, Globals::WindowHeight);
 
+		LoadScene(svgFilepath);
+
+		m_Pipeline = new GPUPipeline(IsGPUProfilingEnabled());
+		m_Pipeline->Init();
+
+		// Everything is uploaded, the mapping is not needed anymore
+		m_SceneCache.Close();
+		Globals::Scene = SceneView();
+	}
+
+	bool Application::InitHeadless(const std::filesystem::path& svgFilepath, const std::filesystem::path& outputFilepath, CPUMode cpuMode)
+	{
+		m_Scheduler.Init(TaskSchedulerConfig::FromEnvironment());
+
+		// An empty image would look like a valid render in a batch job, so nothing is written
+		if (!LoadScene(svgFilepath))
+		{
+			return false;
+		}
+
+		if (m_SceneCache.IsOpen())
+		{
+			// The CPU pipeline works on the scene in place, so it needs its own copy
+			m_SceneCache.CopyTo(Globals::AllPaths);
+			m_SceneCache.Close();
+			Globals::Scene = Globals::AllPaths.GetView();
+		}
+
+		m_Pipeline = new CPUPipeline(cpuMode, m_Scheduler, outputFilepath);
+		m_Pipeline->Init();
+		return true;
+	}
+
+	bool Application::LoadScene(const std::filesystem::path& svgFilepath)
+	{
+		Globals::SceneVersion++;
+
+		// Scene cache written by an earlier run, if the SVG did not change since
+		Timer timerCache;
+		if (m_SceneCache.Open(svgFilepath))
+		{
+			Globals::Scene = m_SceneCache.GetView();
+			SR_TRACE("Loading scene cache: {0} ms", timerCache.ElapsedMillis());
+			return true;
+		}
+
+		// 1.pass: Find the paths and resolve the attributes of their groups, sequential
+		Timer timerScan;
+		SvgDocument document;
+		if (!SvgParser::Scan(svgFilepath, document))
+		{
+			SR_ERROR("Could not load {0}", svgFilepath.string());
+			return false;
+		}
+
+		SR_TRACE("Scanning: {0} ms", timerScan.ElapsedMillis());
+
+		// 2.pass: Parse the data of the paths into commands, every path is independent
 		Timer timerParse;
-		SvgNode* root = SvgParser::Parse(svgFilepath);
+		const uint32_t pathCount = static_cast<uint32_t>(document.paths.size());
+		std::vector<FillCommands> fillCommands(pathCount);
+		m_Scheduler.ParallelFor(0, pathCount, [&](uint32_t i)
+		{
+			thread_local SvgPath path; // Reused by all the paths parsed on the thread, so the segments are allocated only a few times
+			SvgParser::ParsePath(document.paths[i], path);
+			BuildFillCommands(path, fillCommands[i]);
+			if (path.stroke.hasStroke)
+			{
+				//AddStrokePath(path, builder);
+			}
+		});
+
 		SR_TRACE("Parsing: {0} ms", timerParse.ElapsedMillis());
 
-		// This actually fills information about colors and other attributes from the SVG root node
-		ProcessSvgNode(root);
-		delete root;
+		// 3.pass: Copy the commands into the scene, at offsets given by prefix sums
+		Timer timerCopy;
+		AddFillPaths(document, fillCommands, m_Scheduler);
+		SR_TRACE("Copying: {0} ms", timerCopy.ElapsedMillis());
 
-		m_Pipeline = new GPUPipeline();
-		m_Pipeline->Init();
+		Globals::Scene = Globals::AllPaths.GetView();
+		if (!SceneCache::Write(svgFilepath, document.file.GetView(), Globals::AllPaths))
+		{
+			SR_WARN("Could not write the scene cache {0}", SceneCache::GetCachePath(svgFilepath).string());
+		}
+
+		return true;
 	}
 
 	void Application::Shutdown()
 	{
-		Renderer::Shutdown();
-		m_Window->Close();
+		// There is no pipeline if the headless initialization failed
+		if (m_Pipeline)
+		{
+			m_Pipeline->Shutdown();
+			delete m_Pipeline;
+			m_Pipeline = nullptr;
+		}
+
+		if (m_Window)
+		{
+			Renderer::Shutdown();
+			m_Window->Close();
+		}
+
+		m_Scheduler.Shutdown();
 	}
 
 	void Application::HandleInput()
@@ -522,8 +599,18 @@ namespace SvgRenderer {
 		Globals::GlobalTransform = glm::translate(glm::mat4(1.0f), pos) * glm::scale(glm::mat4(1.0f), glm::vec3(scale, scale, 1.0f));
 	}
 
-	void Application::Run()
+	bool Application::Run()
 	{
+		if (!m_Window)
+		{
+			// Headless, there is nothing to present, so just render one frame, the pipeline is always the CPU one
+			Timer timer;
+			m_Pipeline->Render();
+			m_Pipeline->Final();
+			SR_INFO("Frametime: {0} ms", timer.ElapsedMillis());
+			return static_cast<const CPUPipeline*>(m_Pipeline)->IsImageSaved();
+		}
+
 		m_Running = true;
 		while (m_Running)
 		{
@@ -531,11 +618,27 @@ namespace SvgRenderer {
 
 			//HandleInput();
 
-			m_Pipeline->Render();
+			// Nothing the pipeline depends on changed, so the vertices and the atlas of the last frame are presented again,
+			// unless the last frame did not fit into the scene buffers of the pipeline
+			const FrameState frameState = GetFrameState();
+			const bool isDirty = !m_HasRendered || frameState != m_LastFrameState || m_Pipeline->CheckOverflow();
+			if (isDirty)
+			{
+				m_Pipeline->Render();
+				m_LastFrameState = frameState;
+				m_HasRendered = true;
+			}
+
 			m_Pipeline->Final();
 			glFinish();
 
-			m_Window->OnUpdate();
+			if (isDirty)
+			{
+				SR_INFO("Frametime: {0} ms", timer.ElapsedMillis());
+			}
+
+			// Waiting starts only after a frame that did not render, so the new frame is on the screen and its overflow was checked
+			m_Window->OnUpdate(m_FramePacing == FramePacing::OnEvents && !isDirty);
 
 			for (const Event& e : m_Window->GetAllEvents())
 			{
@@ -550,9 +653,19 @@ namespace SvgRenderer {
 				}
 			}
 			m_Window->ClearEvents();
-
-			SR_INFO("Frametime: {0} ms", timer.ElapsedMillis());
 		}
+
+		return true;
+	}
+
+	Application::FrameState Application::GetFrameState() const
+	{
+		return FrameState{
+			.transform = Globals::GlobalTransform,
+			.width = Globals::WindowWidth,
+			.height = Globals::WindowHeight,
+			.sceneVersion = Globals::SceneVersion
+		};
 	}
 
 	void Application::OnWindowClose()
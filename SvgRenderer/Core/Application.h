@@ -1,9 +1,12 @@
 #pragma once
 
 #include "core/Window.h"
+#include "core/TaskScheduler.h"
 
+#include "Renderer/Pipeline/CPUPipeline.h"
 #include "Renderer/TileBuilder.h"
 #include "Renderer/Rasterizer.h"
+#include "Renderer/SceneCache.h"
 
 #include <glm/glm.hpp>
 
@@ -13,13 +16,23 @@ namespace SvgRenderer {
 	class Shader;
 	class Pipeline;
 
+	enum class FramePacing
+	{
+		Continuous = 0, // Polls the events and presents a frame as fast as possible
+		OnEvents // Blocks on the window events while nothing changes
+	};
+
 	class Application
 	{
 	public:
-		void Init(const std::filesystem::path& svgFilepath);
+		void Init(const std::filesystem::path& svgFilepath, FramePacing framePacing = FramePacing::OnEvents);
+		// Renders a single frame on the CPU without creating a window or an OpenGL context,
+		// and writes it to the output file (PPM or PNG). Returns false if the SVG could not be loaded
+		bool InitHeadless(const std::filesystem::path& svgFilepath, const std::filesystem::path& outputFilepath, CPUMode cpuMode = CPUMode::Par);
 		void Shutdown();
 
-		void Run();
+		// Returns false if the headless frame could not be written
+		bool Run();
 	public:
 		static Application& Get() { return s_Instance; }
 	public:
@@ -32,10 +45,24 @@ namespace SvgRenderer {
 		static void OnMouseReleasedStatic(int button) { Get().OnMouseReleased(button); }
 
 		static void OnViewportResizeStatic(uint32_t width, uint32_t height) { Get().OnViewportResize(width, height); }
+	private:
+		// Everything the rendered frame depends on, the frame is rendered again only when this changes
+		struct FrameState
+		{
+			glm::mat4 transform;
+			uint32_t width;
+			uint32_t height;
+			uint32_t sceneVersion;
+
+			bool operator==(const FrameState& other) const = default;
+		};
 	private:
 		Application() = default;
 
+		// Returns false if the SVG could not be read, the scene is empty then
+		bool LoadScene(const std::filesystem::path& svgFilepath);
 		void HandleInput();
+		FrameState GetFrameState() const;
 
 		void OnWindowClose();
 
@@ -49,8 +76,14 @@ namespace SvgRenderer {
 	private:
 		bool m_Running = false;
 		Scope<Window> m_Window;
+		FramePacing m_FramePacing = FramePacing::OnEvents;
+
+		FrameState m_LastFrameState;
+		bool m_HasRendered = false;
 
 		Pipeline* m_Pipeline = nullptr;
+		SceneCache m_SceneCache;
+		TaskScheduler m_Scheduler; // Loader and CPU pipeline, created first and destroyed last
 	private:
 		static Application s_Instance;
 	};
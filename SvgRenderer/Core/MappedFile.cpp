@@ -0,0 +1,147 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace SvgRenderer {
+
+	MappedFile::MappedFile(const std::filesystem::path& path)
+	{
+		Open(path);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Close();
+			std::swap(m_Data, other.m_Data);
+			std::swap(m_Size, other.m_Size);
+#ifdef _WIN32
+			std::swap(m_FileHandle, other.m_FileHandle);
+			std::swap(m_MappingHandle, other.m_MappingHandle);
+#endif
+		}
+
+		return *this;
+	}
+
+#ifdef _WIN32
+	bool MappedFile::Open(const std::filesystem::path& path)
+	{
+		Close();
+
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			SR_ERROR("Could not open file {0}", path.string());
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			// Empty files cannot be mapped
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		const void* data = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (data == nullptr)
+		{
+			SR_ERROR("Could not map file {0}", path.string());
+			if (mapping != nullptr)
+				CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		m_FileHandle = file;
+		m_MappingHandle = mapping;
+		m_Data = static_cast<const char*>(data);
+		m_Size = static_cast<size_t>(size.QuadPart);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data != nullptr)
+		{
+			UnmapViewOfFile(m_Data);
+			CloseHandle(m_MappingHandle);
+			CloseHandle(m_FileHandle);
+		}
+
+		m_Data = nullptr;
+		m_Size = 0;
+		m_FileHandle = nullptr;
+		m_MappingHandle = nullptr;
+	}
+#else
+	bool MappedFile::Open(const std::filesystem::path& path)
+	{
+		Close();
+
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			SR_ERROR("Could not open file {0}", path.string());
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			// Empty files cannot be mapped
+			close(fd);
+			return false;
+		}
+
+		void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd); // The mapping keeps its own reference to the file
+		if (data == MAP_FAILED)
+		{
+			SR_ERROR("Could not map file {0}", path.string());
+			return false;
+		}
+
+		// The file is read front to back, let the OS read ahead
+		madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+		m_Data = static_cast<const char*>(data);
+		m_Size = static_cast<size_t>(info.st_size);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data != nullptr)
+		{
+			munmap(const_cast<char*>(m_Data), m_Size);
+		}
+
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+#endif
+
+}
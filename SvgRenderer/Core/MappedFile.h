@@ -0,0 +1,38 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+
+namespace SvgRenderer {
+
+	// Read-only mapping of a whole file, the pages are loaded by the OS on the first access
+	// and can be dropped again under memory pressure, so big files do not need a heap copy
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		explicit MappedFile(const std::filesystem::path& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		bool Open(const std::filesystem::path& path);
+		void Close();
+
+		bool IsOpen() const { return m_Data != nullptr; }
+		const char* GetData() const { return m_Data; }
+		size_t GetSize() const { return m_Size; }
+		std::string_view GetView() const { return std::string_view(m_Data, m_Size); }
+	private:
+		const char* m_Data = nullptr;
+		size_t m_Size = 0;
+#ifdef _WIN32
+		void* m_FileHandle = nullptr;
+		void* m_MappingHandle = nullptr;
+#endif
+	};
+
+}
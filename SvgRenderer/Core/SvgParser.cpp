@@ -1,163 +1,307 @@
 #include "SvgParser.h"
 
-#include <tinyxml2.h>
+#include "Core/MappedFile.h"
+
+#include <glm/glm.hpp>
 
 #include <bitset>
+#include <cfloat>
+#include <charconv>
 
 namespace SvgRenderer {
 
-	using namespace tinyxml2;
-
-	static std::string_view ExtractFirstNumberString(std::string_view str)
+	// Reads the numbers of a path or a transform straight from the string, without any allocation.
+	// Numbers may be separated by whitespace, commas, or nothing at all, like in "1-2.5.5"
+	class NumberScanner
 	{
-		if (str.empty())
-			return str;
+	public:
+		explicit NumberScanner(std::string_view str)
+			: m_Str(str) {}
+
+		// Skips the separators and returns the next character, or '\0' at the end
+		char Peek()
+		{
+			while (m_Pos < m_Str.size() && (m_Str[m_Pos] == ',' || std::isspace(static_cast<unsigned char>(m_Str[m_Pos]))))
+			{
+				m_Pos++;
+			}
+
+			return m_Pos < m_Str.size() ? m_Str[m_Pos] : '\0';
+		}
 
-		bool readMinus = false;
-		bool readDot = false;
-		bool readExp = false;
+		void Advance() { m_Pos++; }
 
-		size_t i = 0;
-		for (; i < str.length(); i++)
+		bool IsAtNumber()
 		{
-			switch (str[i])
+			const char c = Peek();
+			return std::isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '+' || c == '.';
+		}
+
+		bool Next(float& value)
+		{
+			if (!IsAtNumber())
 			{
-			case '-':
-				if (readMinus)
-				{
-					if (str[i - 1] != 'e')
-						goto end;
-				}
-				else if (i != 0)
+				return false;
+			}
+
+			const char* first = m_Str.data() + m_Pos;
+			const char* last = m_Str.data() + m_Str.size();
+			if (*first == '+')
+			{
+				first++;
+			}
+
+			auto [end, error] = std::from_chars(first, last, value);
+			if (error == std::errc::invalid_argument)
+			{
+				// Lone sign or dot, skip it so the caller does not get stuck
+				m_Pos++;
+				return false;
+			}
+
+			m_Pos = end - m_Str.data();
+			if (error == std::errc::result_out_of_range)
+			{
+				// Too large or too small for a float, value is left untouched, so it is read again as a double and clamped,
+				// numbers out of the range of a double are not usable and are skipped
+				double wide;
+				if (std::from_chars(first, last, wide).ec != std::errc())
 				{
-					if (str[i - 1] != 'e')
-						goto end;
+					return false;
 				}
 
-				readMinus = true;
-				break;
-			case '.':
-				if (readDot)
-					goto end;
-				readDot = true;
-				break;
-			case 'e':
-				if (readExp)
-					goto end;
-				readExp = true;
-				break;
-			default:
+				value = static_cast<float>(glm::clamp(wide, -static_cast<double>(FLT_MAX), static_cast<double>(FLT_MAX)));
+			}
+
+			return true;
+		}
+
+		// Reads all the count numbers, or returns false if some of them are missing
+		bool Next(float* values, uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; i++)
 			{
-				if (!std::isdigit(str[i]))
+				if (!Next(values[i]))
 				{
-					goto end;
+					return false;
 				}
 			}
-			}
+
+			return true;
 		}
+	private:
+		std::string_view m_Str;
+		size_t m_Pos = 0;
+	};
 
-	end:
-		auto ss = str.substr(0, i);
-		return ss;
+	static float ParseFloat(std::string_view str)
+	{
+		float value = 0.0f;
+		NumberScanner(str).Next(value);
+		return value;
 	}
 
-	cppcoro::generator<float> SvgParser::ParseNumbersLine(std::string_view str)
+	// Pull reader over the raw document, it understands just enough XML to walk the elements of an SVG.
+	// Comments, CDATA, processing instructions and declarations are skipped and entities are not expanded
+	class XmlReader
 	{
-		const char* nums = "0123456789.-e";
-		while (!str.empty())
+	public:
+		enum class Event
 		{
-			size_t numIndex = str.find_first_of(nums);
-			if (numIndex == std::string_view::npos)
-				break;
+			StartElement = 0, EndElement, End, Error
+		};
+	public:
+		explicit XmlReader(std::string_view xml)
+			: m_Xml(xml) {}
 
-			str = str.substr(numIndex, std::string_view::npos);
-
-			std::string_view numStr = ExtractFirstNumberString(str);
-			std::stringstream ss;
-			ss << numStr;
-			float value;
-			ss >> value;
-
-			co_yield value;
-
-			str = str.substr(numStr.length(), std::string_view::npos);
-
-			//float sign = str[0] == '-' ? -1.0f : 1.0f;
-			//if (sign < 1.0f)
-			//{
-			//	str = str.substr(1, std::string_view::npos);
-			//}
-			//
-			//size_t index = str.find_first_not_of("0123456789.e");
-			//if (index != std::string_view::npos && str[index - 1] == 'e')
-			//{
-			//	index = str.find_first_not_of("0123456789.-e", index);
-			//}
-			//
-			//float value;
-			//std::string_view numStr = str.substr(0, index);
-			//std::stringstream ss;
-			//ss << numStr;
-			//ss >> value;
-			//
-			//co_yield value * sign;
-			//
-			//if (index == std::string_view::npos)
-			//	break;
-			//
-			//str = str.substr(index, std::string_view::npos);
-			//size_t nextIndex = str.find_first_of(nums);
-			//if (nextIndex == std::string_view::npos)
-			//	break;
-			//
-			//str = str.substr(nextIndex, std::string_view::npos);
+		Event Next()
+		{
+			while (true)
+			{
+				const size_t open = m_Xml.find('<', m_Pos);
+				if (open == std::string_view::npos)
+				{
+					return Event::End;
+				}
+
+				m_Pos = open + 1;
+				const std::string_view rest = m_Xml.substr(m_Pos);
+				if (rest.starts_with("!--"))
+				{
+					if (!SkipPast("-->"))
+						return Error("Unterminated comment");
+				}
+				else if (rest.starts_with("![CDATA["))
+				{
+					if (!SkipPast("]]>"))
+						return Error("Unterminated CDATA");
+				}
+				else if (rest.starts_with('?'))
+				{
+					if (!SkipPast("?>"))
+						return Error("Unterminated processing instruction");
+				}
+				else if (rest.starts_with('!'))
+				{
+					if (!SkipDeclaration())
+						return Error("Unterminated declaration");
+				}
+				else if (rest.starts_with('/'))
+				{
+					m_Pos++;
+					m_Name = ReadName();
+					if (!SkipPast(">"))
+						return Error("Unterminated end tag");
+					return Event::EndElement;
+				}
+				else
+				{
+					return ReadStartElement();
+				}
+			}
 		}
-	}
 
-	cppcoro::generator<const std::pair<char, std::vector<float>>&> SvgParser::ParseNumbersUntilOneOf(std::string_view str, std::string_view untilOneOf)
-	{
-		const char* nums = "0123456789.-";
+		std::string_view GetName() const { return m_Name; }
+		std::span<const SvgAttribute> GetAttributes() const { return m_Attributes; }
+		// Element closed in its start tag, like <path/>, there will be no end event for it
+		bool IsEmptyElement() const { return m_IsEmptyElement; }
+	private:
+		Event ReadStartElement()
+		{
+			m_Name = ReadName();
+			m_Attributes.clear();
+			m_IsEmptyElement = false;
+			if (m_Name.empty())
+			{
+				return Error("Missing element name");
+			}
 
-		str = str.substr(str.find_first_of(untilOneOf), std::string_view::npos);
+			while (true)
+			{
+				SkipWhitespace();
+				if (m_Pos >= m_Xml.size())
+				{
+					return Error("Unterminated start tag");
+				}
 
-		while (!str.empty())
-		{
-			std::pair<char, std::vector<float>> result = std::make_pair(str[0], std::vector<float>());
+				const char c = m_Xml[m_Pos];
+				if (c == '>')
+				{
+					m_Pos++;
+					return Event::StartElement;
+				}
+				else if (c == '/')
+				{
+					if (m_Pos + 1 >= m_Xml.size() || m_Xml[m_Pos + 1] != '>')
+						return Error("Invalid start tag");
 
-			str = str.substr(1, std::string_view::npos);
+					m_Pos += 2;
+					m_IsEmptyElement = true;
+					return Event::StartElement;
+				}
 
-			size_t index = str.find_first_of(untilOneOf);
-			if (index == std::string_view::npos)
-			{
-				if (str.find_first_of(nums) == std::string_view::npos)
+				const std::string_view name = ReadName();
+				SkipWhitespace();
+				if (name.empty() || m_Pos >= m_Xml.size() || m_Xml[m_Pos] != '=')
 				{
-					co_yield result;
-					break;
+					return Error("Invalid attribute");
 				}
-				else
+
+				m_Pos++;
+				SkipWhitespace();
+				if (m_Pos >= m_Xml.size() || (m_Xml[m_Pos] != '"' && m_Xml[m_Pos] != '\''))
 				{
-					index = str.length();
+					return Error("Invalid attribute");
 				}
+
+				const size_t end = m_Xml.find(m_Xml[m_Pos], m_Pos + 1);
+				if (end == std::string_view::npos)
+				{
+					return Error("Unterminated attribute");
+				}
+
+				m_Attributes.push_back(SvgAttribute{ .name = name, .value = m_Xml.substr(m_Pos + 1, end - m_Pos - 1) });
+				m_Pos = end + 1;
+			}
+		}
+
+		std::string_view ReadName()
+		{
+			const size_t start = m_Pos;
+			while (m_Pos < m_Xml.size())
+			{
+				const char c = m_Xml[m_Pos];
+				if (std::isspace(static_cast<unsigned char>(c)) || c == '=' || c == '/' || c == '>')
+				{
+					break;
+				}
+
+				m_Pos++;
 			}
 
-			std::string_view lineStr = str.substr(0, index);
+			return m_Xml.substr(start, m_Pos - start);
+		}
 
-			size_t numsIndex = lineStr.find_first_of(nums);
-			if (numsIndex != std::string_view::npos)
+		void SkipWhitespace()
+		{
+			while (m_Pos < m_Xml.size() && std::isspace(static_cast<unsigned char>(m_Xml[m_Pos])))
 			{
-				lineStr = lineStr.substr(numsIndex, std::string_view::npos);
-				for (float value : ParseNumbersLine(lineStr))
-					result.second.push_back(value);
+				m_Pos++;
 			}
+		}
 
-			co_yield result;
+		bool SkipPast(std::string_view terminator)
+		{
+			const size_t end = m_Xml.find(terminator, m_Pos);
+			if (end == std::string_view::npos)
+			{
+				return false;
+			}
 
-			size_t nextIndex = str.find_first_of(untilOneOf);
-			if (nextIndex == std::string_view::npos)
-				break;
+			m_Pos = end + terminator.size();
+			return true;
+		}
+
+		// <!DOCTYPE ...> may contain an internal subset in brackets, with '>' inside
+		bool SkipDeclaration()
+		{
+			uint32_t depth = 0;
+			for (; m_Pos < m_Xml.size(); m_Pos++)
+			{
+				const char c = m_Xml[m_Pos];
+				if (c == '[')
+					depth++;
+				else if (c == ']' && depth > 0)
+					depth--;
+				else if (c == '>' && depth == 0)
+				{
+					m_Pos++;
+					return true;
+				}
+			}
+
+			return false;
+		}
 
-			str = str.substr(nextIndex, std::string_view::npos);
+		Event Error(const char* message)
+		{
+			SR_ERROR("Invalid SVG at offset {0}: {1}", m_Pos, message);
+			return Event::Error;
 		}
+	private:
+		std::string_view m_Xml;
+		size_t m_Pos = 0;
+
+		std::string_view m_Name;
+		std::vector<SvgAttribute> m_Attributes; // Reused by every element, so reading does not allocate
+		bool m_IsEmptyElement = false;
+	};
+
+	static uint8_t ParseHexByte(std::string_view str)
+	{
+		uint32_t value = 0;
+		std::from_chars(str.data(), str.data() + str.size(), value, 16);
+		return static_cast<uint8_t>(value);
 	}
 
 	std::optional<SvgColor> SvgParser::ParseColor(std::string_view colorStr)
@@ -170,42 +314,19 @@ namespace SvgRenderer {
 
 		if (colorStr[0] == '#' && colorStr.size() == 4) // #ABC
 		{
-			uint32_t r, g, b;
-
-			std::stringstream ss;
-			ss << std::hex << colorStr[1] << colorStr[1];
-			ss >> r;
-			ss.clear();
-			ss << std::hex << colorStr[2] << colorStr[2];
-			ss >> g;
-			ss.clear();
-			ss << std::hex << colorStr[3] << colorStr[3];
-			ss >> b;
-
+			// Each digit is doubled, 0xA * 17 = 0xAA
 			return SvgColor{
-				.r = static_cast<uint8_t>(r),
-				.g = static_cast<uint8_t>(g),
-				.b = static_cast<uint8_t>(b)
+				.r = static_cast<uint8_t>(ParseHexByte(colorStr.substr(1, 1)) * 17),
+				.g = static_cast<uint8_t>(ParseHexByte(colorStr.substr(2, 1)) * 17),
+				.b = static_cast<uint8_t>(ParseHexByte(colorStr.substr(3, 1)) * 17)
 			};
 		}
 		else if (colorStr[0] == '#' && colorStr.size() == 7) // #ABCDEF
 		{
-			uint32_t r, g, b;
-
-			std::stringstream ss;
-			ss << std::hex << colorStr[1] << colorStr[2];
-			ss >> r;
-			ss.clear();
-			ss << std::hex << colorStr[3] << colorStr[4];
-			ss >> g;
-			ss.clear();
-			ss << std::hex << colorStr[5] << colorStr[6];
-			ss >> b;
-
 			return SvgColor{
-				.r = static_cast<uint8_t>(r),
-				.g = static_cast<uint8_t>(g),
-				.b = static_cast<uint8_t>(b)
+				.r = ParseHexByte(colorStr.substr(1, 2)),
+				.g = ParseHexByte(colorStr.substr(3, 2)),
+				.b = ParseHexByte(colorStr.substr(5, 2))
 			};
 		}
 
@@ -224,18 +345,9 @@ namespace SvgRenderer {
 	{
 		std::string_view cleanString = str.substr(7, str.size() - 8); // matrix(a b c d e f)
 
-		std::vector<float> m;
-		m.reserve(6);
-
-		for (float value : ParseNumbersLine(cleanString))
-		{
-			if (m.size() == 6)
-				break;
-
-			m.push_back(value);
-		}
-
-		if (m.size() == 6)
+		float m[6];
+		NumberScanner scanner(cleanString);
+		if (scanner.Next(m, 6))
 		{
 			return glm::mat3(
 				{ m[0], m[1], 0.0f },
@@ -249,315 +361,197 @@ namespace SvgRenderer {
 		}
 	}
 
-	std::vector<SvgPath::Segment> SvgParser::ParsePathString(std::string_view str)
+	static uint32_t GetPathCommandNumberCount(char command)
+	{
+		switch (command)
+		{
+		case 'M': case 'm': case 'L': case 'l': case 'T': case 't':
+			return 2;
+		case 'H': case 'h': case 'V': case 'v':
+			return 1;
+		case 'Q': case 'q': case 'S': case 's':
+			return 4;
+		case 'C': case 'c':
+			return 6;
+		}
+
+		return 0;
+	}
+
+	void SvgParser::ParsePathString(std::string_view str, std::vector<SvgPath::Segment>& segments)
 	{
-		const char* tokens = "MmLlHhVvQqCcZzSsTt";
+		constexpr std::string_view tokens = "MmLlHhVvQqCcZzSsTt";
 
-		std::vector<SvgPath::Segment> segments;
+		// Segments are appended, the ones already in the array belong to other paths
+		const size_t firstSegment = segments.size();
+		auto isPreviousSegment = [&segments, firstSegment](SvgPath::Segment::Type type)
+		{
+			return segments.size() > firstSegment && segments.back().type == type;
+		};
+
+		NumberScanner scanner(str);
 
 		glm::vec2 prevPoint = { 0.0f, 0.0f };
 		glm::vec2 firstPoint = { 0.0f, 0.0f };
-		for (const auto& [token, nums] : ParseNumbersUntilOneOf(str, tokens))
+		char command = '\0';
+		while (char c = scanner.Peek())
 		{
-			switch (token)
+			if (std::isalpha(static_cast<unsigned char>(c)))
 			{
-			case 'M':
-				if (!nums.empty() && nums.size() % 2 == 0)
+				scanner.Advance();
+				if (tokens.find(c) == std::string_view::npos)
 				{
-					{
-						glm::vec2 point = { nums[0], nums[1] };
-						segments.push_back(SvgPath::Segment(SvgPath::MoveTo{ .p = point }));
-						prevPoint = point;
-						firstPoint = point;
-					}
-
-					for (size_t i = 2; i < nums.size(); i += 2)
-					{
-						glm::vec2 point = { nums[i], nums[i + 1] };
-						segments.push_back(SvgPath::Segment(SvgPath::MoveTo{ .p = point }));
-						prevPoint = point;
-					}
+					// TODO: Implement arcs, their numbers are skipped until the next command
+					SR_WARN("Unsupported '{0}' in path", c);
+					command = '\0';
+					continue;
 				}
-				else
-					SR_WARN("Invalid 'M' in path");
-				break;
-			case 'm':
-				if (!nums.empty() && nums.size() % 2 == 0)
-				{
-					{
-						glm::vec2 point = prevPoint + glm::vec2(nums[0], nums[0 + 1]);
-						segments.push_back(SvgPath::Segment(SvgPath::MoveTo{ .p = point }));
-						prevPoint = point;
-						firstPoint = point;
-					}
 
-					for (size_t i = 2; i < nums.size(); i += 2)
-					{
-						glm::vec2 point = prevPoint + glm::vec2(nums[i], nums[i + 1]);
-						segments.push_back(SvgPath::Segment(SvgPath::LineTo{ .p = point }));
-						prevPoint = point;
-					}
-				}
-				else
-					SR_WARN("Invalid 'm' in path");
-				break;
-			case 'L':
-				if (!nums.empty() && nums.size() % 2 == 0)
-				{
-					for (size_t i = 0; i < nums.size(); i += 2)
-					{
-						glm::vec2 point = { nums[i], nums[i + 1] };
-						segments.push_back(SvgPath::Segment(SvgPath::LineTo{ .p = point }));
-						prevPoint = point;
-					}
-				}
-				else
-					SR_WARN("Invalid 'M' in path");
-				break;
-			case 'l':
-				if (!nums.empty() && nums.size() % 2 == 0)
-				{
-					for (size_t i = 0; i < nums.size(); i += 2)
-					{
-						glm::vec2 point = prevPoint + glm::vec2(nums[i], nums[i + 1]);
-						segments.push_back(SvgPath::Segment(SvgPath::LineTo{ .p = point }));
-						prevPoint = point;
-					}
-				}
-				else
-					SR_WARN("Invalid 'l' in path");
-				break;
-			case 'Z':
-			case 'z':
-				if (nums.empty())
+				command = c;
+				if (command == 'Z' || command == 'z')
 				{
 					segments.push_back(SvgPath::Segment(SvgPath::Close{}));
 					prevPoint = firstPoint;
+					continue;
 				}
-				else
-					SR_WARN("Invalid 'Z/z' in path");
-				break;
-			case 'H':
-				if (!nums.empty())
+
+				if (!scanner.IsAtNumber())
 				{
-					glm::vec2 point = { nums[nums.size() - 1], prevPoint.y };
-					segments.push_back(SvgPath::Segment(SvgPath::LineTo{ .p = point }));
-					prevPoint = point;
+					SR_WARN("Invalid '{0}' in path", command);
+					continue;
 				}
-				else
-					SR_WARN("Invalid 'H' in path");
+			}
+			else if (command == '\0' || command == 'Z' || command == 'z' || !scanner.IsAtNumber())
+			{
+				scanner.Advance();
+				continue;
+			}
+
+			// The command letter may be followed by several sets of numbers, each one is a segment
+			float n[6];
+			if (!scanner.Next(n, GetPathCommandNumberCount(command)))
+			{
+				SR_WARN("Invalid '{0}' in path", command);
+				continue;
+			}
+
+			switch (command)
+			{
+			case 'M':
+			{
+				glm::vec2 point = { n[0], n[1] };
+				segments.push_back(SvgPath::Segment(SvgPath::MoveTo{ .p = point }));
+				prevPoint = point;
+				firstPoint = point;
+				command = 'L'; // Next pairs are line segments
+				break;
+			}
+			case 'm':
+			{
+				glm::vec2 point = prevPoint + glm::vec2(n[0], n[1]);
+				segments.push_back(SvgPath::Segment(SvgPath::MoveTo{ .p = point }));
+				prevPoint = point;
+				firstPoint = point;
+				command = 'l';
 				break;
+			}
+			case 'L':
+			case 'l':
+			{
+				glm::vec2 point = command == 'L' ? glm::vec2(n[0], n[1]) : prevPoint + glm::vec2(n[0], n[1]);
+				segments.push_back(SvgPath::Segment(SvgPath::LineTo{ .p = point }));
+				prevPoint = point;
+				break;
+			}
+			case 'H':
 			case 'h':
-				if (!nums.empty())
-				{
-					float accum = 0.0f;
-					for (float n : nums)
-						accum += n;
-
-					glm::vec2 point = { prevPoint.x + accum, prevPoint.y };
-					segments.push_back(SvgPath::Segment(SvgPath::LineTo{ .p = point }));
-					prevPoint = point;
-				}
-				else
-					SR_WARN("Invalid 'h' in path");
+			{
+				glm::vec2 point = { command == 'H' ? n[0] : prevPoint.x + n[0], prevPoint.y };
+				segments.push_back(SvgPath::Segment(SvgPath::LineTo{ .p = point }));
+				prevPoint = point;
 				break;
+			}
 			case 'V':
-				if (!nums.empty())
-				{
-					glm::vec2 point = { prevPoint.x, nums[nums.size() - 1]};
-					segments.push_back(SvgPath::Segment(SvgPath::LineTo{ .p = point }));
-					prevPoint = point;
-				}
-				else
-					SR_WARN("Invalid 'V' in path");
-				break;
 			case 'v':
-				if (!nums.empty())
-				{
-					float accum = 0.0f;
-					for (float n : nums)
-						accum += n;
-
-					glm::vec2 point = { prevPoint.x, prevPoint.y + accum };
-					segments.push_back(SvgPath::Segment(SvgPath::LineTo{ .p = point }));
-					prevPoint = point;
-				}
-				else
-					SR_WARN("Invalid 'v' in path");
+			{
+				glm::vec2 point = { prevPoint.x, command == 'V' ? n[0] : prevPoint.y + n[0] };
+				segments.push_back(SvgPath::Segment(SvgPath::LineTo{ .p = point }));
+				prevPoint = point;
 				break;
+			}
 			case 'Q':
-				if (!nums.empty() && nums.size() % 4 == 0)
-				{
-					for (size_t i = 0; i < nums.size(); i += 4)
-					{
-						glm::vec2 p1 = { nums[i + 0], nums[i + 1] };
-						glm::vec2 p2 = { nums[i + 2], nums[i + 3] };
-						segments.push_back(SvgPath::Segment(SvgPath::QuadTo{ .p1 = p1, .p2 = p2 }));
-						prevPoint = p2;
-					}
-				}
-				else
-					SR_WARN("Invalid 'Q' in path");
-				break;
 			case 'q':
-				if (!nums.empty() && nums.size() % 4 == 0)
-				{
-					for (size_t i = 0; i < nums.size(); i += 4)
-					{
-						glm::vec2 p1 = prevPoint + glm::vec2(nums[i + 0], nums[i + 1]);
-						glm::vec2 p2 = prevPoint + glm::vec2(nums[i + 2], nums[i + 3]);
-						segments.push_back(SvgPath::Segment(SvgPath::QuadTo{ .p1 = p1, .p2 = p2 }));
-						prevPoint = p2;
-					}
-				}
-				else
-					SR_WARN("Invalid 'q' in path");
+			{
+				const glm::vec2 offset = command == 'q' ? prevPoint : glm::vec2(0.0f, 0.0f);
+				glm::vec2 p1 = offset + glm::vec2(n[0], n[1]);
+				glm::vec2 p2 = offset + glm::vec2(n[2], n[3]);
+				segments.push_back(SvgPath::Segment(SvgPath::QuadTo{ .p1 = p1, .p2 = p2 }));
+				prevPoint = p2;
 				break;
+			}
 			case 'C':
-				if (!nums.empty() && nums.size() % 6 == 0)
-				{
-					for (size_t i = 0; i < nums.size(); i += 6)
-					{
-						glm::vec2 p1 = { nums[i + 0], nums[i + 1] };
-						glm::vec2 p2 = { nums[i + 2], nums[i + 3] };
-						glm::vec2 p3 = { nums[i + 4], nums[i + 5] };
-						segments.push_back(SvgPath::Segment(SvgPath::CubicTo{ .p1 = p1, .p2 = p2, .p3 = p3 }));
-						prevPoint = p3;
-					}
-				}
-				else
-					SR_WARN("Invalid 'C' in path");
-				break;
 			case 'c':
-				if (!nums.empty() && nums.size() % 6 == 0)
-				{
-					for (size_t i = 0; i < nums.size(); i += 6)
-					{
-						glm::vec2 p1 = prevPoint + glm::vec2(nums[i + 0], nums[i + 1]);
-						glm::vec2 p2 = prevPoint + glm::vec2(nums[i + 2], nums[i + 3]);
-						glm::vec2 p3 = prevPoint + glm::vec2(nums[i + 4], nums[i + 5]);
-						segments.push_back(SvgPath::Segment(SvgPath::CubicTo{ .p1 = p1, .p2 = p2, .p3 = p3 }));
-						prevPoint = p3;
-					}
-				}
-				else
-					SR_WARN("Invalid 'c' in path");
+			{
+				const glm::vec2 offset = command == 'c' ? prevPoint : glm::vec2(0.0f, 0.0f);
+				glm::vec2 p1 = offset + glm::vec2(n[0], n[1]);
+				glm::vec2 p2 = offset + glm::vec2(n[2], n[3]);
+				glm::vec2 p3 = offset + glm::vec2(n[4], n[5]);
+				segments.push_back(SvgPath::Segment(SvgPath::CubicTo{ .p1 = p1, .p2 = p2, .p3 = p3 }));
+				prevPoint = p3;
 				break;
+			}
 			case 'T':
-				if (!nums.empty() && nums.size() % 2 == 0)
+				if (!isPreviousSegment(SvgPath::Segment::Type::QuadTo))
 				{
-					// TODO: Could be optimized, because after one loop, we know there will be quad segment as the last one
-					for (size_t i = 0; i < nums.size(); i += 2)
-					{
-						if (segments.empty() || segments.back().type != SvgPath::Segment::Type::QuadTo)
-						{
-							glm::vec2 point = { nums[i], nums[i + 1] };
-							segments.push_back(SvgPath::Segment(SvgPath::LineTo{ .p = point }));
-							prevPoint = point;
-						}
-						else
-						{
-							const SvgPath::QuadTo& prevQuad = segments.back().as.quadTo;
-							glm::vec2 p1 = prevPoint + (prevPoint - prevQuad.p1);
-							glm::vec2 p2 = { nums[i], nums[i + 1] };
-							segments.push_back(SvgPath::Segment(SvgPath::QuadTo{ .p1 = p1, .p2 = p2 }));
-							prevPoint = p2;
-						}
-					}
+					glm::vec2 point = { n[0], n[1] };
+					segments.push_back(SvgPath::Segment(SvgPath::LineTo{ .p = point }));
+					prevPoint = point;
 				}
 				else
-					SR_WARN("Invalid 'T' in path");
-				break;
-			case 't':
-				if (!nums.empty() && nums.size() % 2 == 0)
 				{
-					// TODO: Could be optimized, same reason as above
-					for (size_t i = 0; i < nums.size(); i += 2)
-					{
-						if (segments.empty() || segments.back().type != SvgPath::Segment::Type::QuadTo)
-						{
-							glm::vec2 p1 = prevPoint;
-							glm::vec2 p2 = prevPoint + glm::vec2(nums[i], nums[i + 1]);
-							segments.push_back(SvgPath::Segment(SvgPath::QuadTo{ .p1 = p1, .p2 = p2 }));
-							prevPoint = p2;
-						}
-						else
-						{
-							const SvgPath::QuadTo& prevQuad = segments.back().as.quadTo;
-							glm::vec2 p1 = prevPoint + (prevPoint - prevQuad.p1);
-							glm::vec2 p2 = prevPoint + glm::vec2(nums[i], nums[i + 1]);
-							segments.push_back(SvgPath::Segment(SvgPath::QuadTo{ .p1 = p1, .p2 = p2 }));
-							prevPoint = p2;
-						}
-					}
+					const SvgPath::QuadTo& prevQuad = segments.back().as.quadTo;
+					glm::vec2 p1 = prevPoint + (prevPoint - prevQuad.p1);
+					glm::vec2 p2 = { n[0], n[1] };
+					segments.push_back(SvgPath::Segment(SvgPath::QuadTo{ .p1 = p1, .p2 = p2 }));
+					prevPoint = p2;
 				}
-				else
-					SR_WARN("Invalid 't' in path");
 				break;
-			case 'S':
-				if (!nums.empty() && nums.size() % 4 == 0)
+			case 't':
+			{
+				// Without a previous quad the control point is the current point
+				glm::vec2 p1 = prevPoint;
+				if (isPreviousSegment(SvgPath::Segment::Type::QuadTo))
 				{
-					// TODO: Could be optimized, same reason as above
-					for (size_t i = 0; i < nums.size(); i += 4)
-					{
-						if (segments.empty() || segments.back().type != SvgPath::Segment::Type::CubicTo)
-						{
-							glm::vec2 p1 = prevPoint;
-							glm::vec2 p2 = { nums[i + 0], nums[i + 1] };
-							glm::vec2 p3 = { nums[i + 2], nums[i + 3] };
-							segments.push_back(SvgPath::Segment(SvgPath::CubicTo{ .p1 = p1, .p2 = p2, .p3 = p3 }));
-							prevPoint = p3;
-						}
-						else
-						{
-							const SvgPath::CubicTo& prevCubic = segments.back().as.cubicTo;
-							glm::vec2 p1 = prevPoint + (prevPoint - prevCubic.p2);
-							glm::vec2 p2 = { nums[i + 0], nums[i + 1] };
-							glm::vec2 p3 = { nums[i + 2], nums[i + 3] };
-							segments.push_back(SvgPath::Segment(SvgPath::CubicTo{ .p1 = p1, .p2 = p2, .p3 = p3 }));
-							prevPoint = p3;
-						}
-					}
+					p1 = prevPoint + (prevPoint - segments.back().as.quadTo.p1);
 				}
-				else
-					SR_WARN("Invalid 'S' in path");
+
+				glm::vec2 p2 = prevPoint + glm::vec2(n[0], n[1]);
+				segments.push_back(SvgPath::Segment(SvgPath::QuadTo{ .p1 = p1, .p2 = p2 }));
+				prevPoint = p2;
 				break;
+			}
+			case 'S':
 			case 's':
-				if (nums.size() % 4 == 0)
+			{
+				// Without a previous cubic the first control point is the current point
+				const glm::vec2 offset = command == 's' ? prevPoint : glm::vec2(0.0f, 0.0f);
+				glm::vec2 p1 = prevPoint;
+				if (isPreviousSegment(SvgPath::Segment::Type::CubicTo))
 				{
-					// TODO: Could be optimized, same reason as above
-					for (size_t i = 0; i < nums.size(); i += 4)
-					{
-						if (segments.empty() || segments.back().type != SvgPath::Segment::Type::CubicTo)
-						{
-							glm::vec2 p1 = prevPoint;
-							glm::vec2 p2 = prevPoint + glm::vec2(nums[i + 0], nums[i + 1]);
-							glm::vec2 p3 = prevPoint + glm::vec2(nums[i + 2], nums[i + 3]);
-							segments.push_back(SvgPath::Segment(SvgPath::CubicTo{ .p1 = p1, .p2 = p2, .p3 = p3 }));
-							prevPoint = p3;
-						}
-						else
-						{
-							const SvgPath::CubicTo& prevCubic = segments.back().as.cubicTo;
-							glm::vec2 p1 = prevPoint + (prevPoint - prevCubic.p2);
-							glm::vec2 p2 = prevPoint + glm::vec2(nums[i + 0], nums[i + 1]);
-							glm::vec2 p3 = prevPoint + glm::vec2(nums[i + 2], nums[i + 3]);
-							segments.push_back(SvgPath::Segment(SvgPath::CubicTo{ .p1 = p1, .p2 = p2, .p3 = p3 }));
-							prevPoint = p3;
-						}
-					}
+					p1 = prevPoint + (prevPoint - segments.back().as.cubicTo.p2);
 				}
-				else
-					SR_WARN("Invalid 's' in path");
+
+				glm::vec2 p2 = offset + glm::vec2(n[0], n[1]);
+				glm::vec2 p3 = offset + glm::vec2(n[2], n[3]);
+				segments.push_back(SvgPath::Segment(SvgPath::CubicTo{ .p1 = p1, .p2 = p2, .p3 = p3 }));
+				prevPoint = p3;
 				break;
-			// TODO: Implement arcs
+			}
 			}
 		}
-
-		return segments;
 	}
 
-	SvgNode* SvgParser::ParseSvgGroup(const XMLElement* element, const SvgGroup& previous)
+	SvgGroup SvgParser::ParseSvgGroup(std::span<const SvgAttribute> attributes, const SvgGroup& previous)
 	{
 		enum Flag : size_t
 		{
@@ -576,12 +570,12 @@ namespace SvgRenderer {
 
 		SvgGroup group;
 
-		for (const XMLAttribute* attr = element->FirstAttribute(); attr != nullptr; attr = attr->Next())
+		for (const SvgAttribute& attr : attributes)
 		{
-			std::string_view attrName = std::string_view(attr->Name());
+			std::string_view attrName = attr.name;
 			if (attrName == "fill")
 			{
-				std::optional<SvgColor> color = ParseColor(attr->Value());
+				std::optional<SvgColor> color = ParseColor(attr.value);
 				if (color)
 				{
 					flags.set(Flag::Fill, true);
@@ -590,7 +584,7 @@ namespace SvgRenderer {
 			}
 			else if (attrName == "stroke")
 			{
-				std::optional<SvgColor> color = ParseColor(attr->Value());
+				std::optional<SvgColor> color = ParseColor(attr.value);
 				if (color)
 				{
 					flags.set(Flag::Stroke, true);
@@ -600,7 +594,7 @@ namespace SvgRenderer {
 			else if (attrName == "fill-opacity")
 			{
 				flags.set(Flag::FillOpacity, true);
-				group.fill.opacity = attr->FloatValue();
+				group.fill.opacity = ParseFloat(attr.value);
 			}
 			else if (attrName == "opacity")
 			{
@@ -610,21 +604,21 @@ namespace SvgRenderer {
 			else if (attrName == "stroke-opacity")
 			{
 				flags.set(Flag::StrokeOpacity, true);
-				group.stroke.opacity = attr->FloatValue();
+				group.stroke.opacity = ParseFloat(attr.value);
 			}
 			else if (attrName == "stroke-width")
 			{
 				flags.set(Flag::StrokeWidth, true);
-				group.stroke.width = attr->FloatValue();
+				group.stroke.width = ParseFloat(attr.value);
 			}
 			else if (attrName == "fill-rule")
 			{
 				flags.set(Flag::FillRule, true);
-				group.fill.fillRule = ParseFillRule(attr->Value());
+				group.fill.fillRule = ParseFillRule(attr.value);
 			}
 			else if (attrName == "transform")
 			{
-				std::optional<glm::mat3> transform = ParseTransform(attr->Value());
+				std::optional<glm::mat3> transform = ParseTransform(attr.value);
 				if (transform)
 				{
 					flags.set(Flag::Transform, true);
@@ -645,10 +639,10 @@ namespace SvgRenderer {
 
 		res.transform = flags.test(Flag::Transform) ? group.transform * previous.transform : previous.transform;
 
-		return new SvgNode(res);
+		return res;
 	}
 
-	SvgNode* SvgParser::ParseSvgPath(const XMLElement* element, const SvgGroup& group)
+	bool SvgParser::ParseSvgPath(std::span<const SvgAttribute> attributes, const SvgGroup& group, SvgPathSource& source)
 	{
 		enum Flag : size_t
 		{
@@ -659,134 +653,180 @@ namespace SvgRenderer {
 			StrokeWidth,
 			FillRule,
 			Transform,
-			Segments,
 
 			FlagCount
 		};
 
 		std::bitset<Flag::FlagCount> flags;
 
-		SvgPath path;
+		source.data = {};
 
-		for (const XMLAttribute* attr = element->FirstAttribute(); attr != nullptr; attr = attr->Next())
+		for (const SvgAttribute& attr : attributes)
 		{
-			std::string_view attrName = std::string_view(attr->Name());
+			std::string_view attrName = attr.name;
 			if (attrName == "fill")
 			{
-				std::optional<SvgColor> color = ParseColor(attr->Value());
+				std::optional<SvgColor> color = ParseColor(attr.value);
 				if (color)
 				{
 					flags.set(Flag::Fill, true);
-					path.fill.color = *color;
+					source.fill.color = *color;
 				}
 			}
 			else if (attrName == "stroke")
 			{
-				std::optional<SvgColor> color = ParseColor(attr->Value());
+				std::optional<SvgColor> color = ParseColor(attr.value);
 				if (color)
 				{
 					flags.set(Flag::Stroke, true);
-					path.stroke.color = *color;
+					source.stroke.color = *color;
 				}
 			}
 			else if (attrName == "fill-opacity" || attrName == "opacity")
 			{
 				flags.set(Flag::FillOpacity, true);
-				path.fill.opacity = attr->FloatValue();
+				source.fill.opacity = ParseFloat(attr.value);
 			}
 			else if (attrName == "stroke-opacity")
 			{
 				flags.set(Flag::StrokeOpacity, true);
-				path.stroke.opacity = attr->FloatValue();
+				source.stroke.opacity = ParseFloat(attr.value);
 			}
 			else if (attrName == "stroke-width")
 			{
 				flags.set(Flag::StrokeWidth, true);
-				path.stroke.width = attr->FloatValue();
+				source.stroke.width = ParseFloat(attr.value);
 			}
 			else if (attrName == "fill-rule")
 			{
 				flags.set(Flag::FillRule, true);
-				path.fill.fillRule = ParseFillRule(attr->Value());
+				source.fill.fillRule = ParseFillRule(attr.value);
 			}
 			else if (attrName == "transform")
 			{
-				std::optional<glm::mat3> transform = ParseTransform(attr->Value());
+				std::optional<glm::mat3> transform = ParseTransform(attr.value);
 				if (transform)
 				{
 					flags.set(Flag::Transform, true);
-					path.transform = *transform;
+					source.transform = *transform;
 				}
 			}
 			else if (attrName == "d")
 			{
-				path.segments = ParsePathString(attr->Value());
-				if (path.segments.empty())
-				{
-					return nullptr;
-				}
+				source.data = attr.value;
 			}
 		}
 
-		// We return nullptr, if the group did not set any flag, or dont have
-		// any segments in the path, because then it does not have any relevant information
-		if (flags.none() && path.segments.empty())
+		// We return false, if the group did not set any flag, or dont have
+		// any data in the path, because then it does not have any relevant information
+		if (flags.none() && source.data.empty())
 		{
-			return nullptr;
+			return false;
 		}
 
-		path.fill.color = flags.test(Flag::Fill) ? path.fill.color : group.fill.color;
-		path.fill.opacity = flags.test(Flag::FillOpacity) ? path.fill.opacity : group.fill.opacity;
-		path.fill.fillRule = flags.test(Flag::FillRule) ? path.fill.fillRule : group.fill.fillRule;
+		source.fill.color = flags.test(Flag::Fill) ? source.fill.color : group.fill.color;
+		source.fill.opacity = flags.test(Flag::FillOpacity) ? source.fill.opacity : group.fill.opacity;
+		source.fill.fillRule = flags.test(Flag::FillRule) ? source.fill.fillRule : group.fill.fillRule;
 
-		path.stroke.color = flags.test(Flag::Stroke) ? path.stroke.color : group.stroke.color;
-		path.stroke.opacity = flags.test(Flag::StrokeOpacity) ? path.stroke.opacity : group.stroke.opacity;
-		path.stroke.width = flags.test(Flag::StrokeWidth) ? path.stroke.width : group.stroke.width;
-		path.stroke.hasStroke = (flags.test(Flag::Stroke) || group.stroke.hasStroke) && path.stroke.opacity > 0.0f && path.stroke.width != 0.0f;
+		source.stroke.color = flags.test(Flag::Stroke) ? source.stroke.color : group.stroke.color;
+		source.stroke.opacity = flags.test(Flag::StrokeOpacity) ? source.stroke.opacity : group.stroke.opacity;
+		source.stroke.width = flags.test(Flag::StrokeWidth) ? source.stroke.width : group.stroke.width;
+		source.stroke.hasStroke = (flags.test(Flag::Stroke) || group.stroke.hasStroke) && source.stroke.opacity > 0.0f && source.stroke.width != 0.0f;
 
-		path.transform = flags.test(Flag::Transform) ? group.transform * path.transform : group.transform;
+		source.transform = flags.test(Flag::Transform) ? group.transform * source.transform : group.transform;
 
-		return new SvgNode(path);
+		return true;
 	}
 
-	void SvgParser::IterateElements(const XMLElement* element, SvgNode* parent, SvgGroup accumulatedGroup)
+	bool SvgParser::Scan(const std::filesystem::path& path, SvgDocument& document)
 	{
-		for (const XMLElement* child = element->FirstChildElement(); child != nullptr; child = child->NextSiblingElement())
+		document.paths.clear();
+		if (!document.file.Open(path))
 		{
-			SvgNode* node = nullptr;
+			return false;
+		}
 
-			std::string_view name = child->Name();
-			if (name == "g")
+		// Accumulated groups of the open elements, children of the last one inherit its attributes.
+		// Elements that are neither groups nor paths, like <defs>, are skipped together with their content
+		std::vector<SvgGroup> accumulatedGroups;
+		uint32_t skipDepth = 0;
+
+		XmlReader reader(document.file.GetView());
+		while (true)
+		{
+			switch (reader.Next())
 			{
-				node = ParseSvgGroup(child, accumulatedGroup);
-			}
-			else if (name == "path")
+			case XmlReader::Event::StartElement:
 			{
-				node = ParseSvgPath(child, accumulatedGroup);
-			}
+				if (skipDepth > 0)
+				{
+					skipDepth += reader.IsEmptyElement() ? 0 : 1;
+					break;
+				}
 
-			if (node != nullptr)
-			{
-				parent->children.push_back(node);
-				IterateElements(child, node, node->type == SvgNodeType::Group ? node->as.group : accumulatedGroup);
+				if (accumulatedGroups.empty())
+				{
+					// Root <svg> element
+					accumulatedGroups.push_back(SvgGroup::CreateDefault());
+					break;
+				}
+
+				const SvgGroup accumulatedGroup = accumulatedGroups.back();
+
+				bool hasNode = false;
+				std::string_view name = reader.GetName();
+				if (name == "g")
+				{
+					hasNode = true;
+					if (!reader.IsEmptyElement())
+					{
+						accumulatedGroups.push_back(ParseSvgGroup(reader.GetAttributes(), accumulatedGroup));
+					}
+				}
+				else if (name == "path")
+				{
+					SvgPathSource source;
+					hasNode = ParseSvgPath(reader.GetAttributes(), accumulatedGroup, source);
+					if (hasNode && !source.data.empty())
+					{
+						document.paths.push_back(source);
+					}
+
+					if (hasNode && !reader.IsEmptyElement())
+					{
+						accumulatedGroups.push_back(accumulatedGroup);
+					}
+				}
+
+				if (!hasNode && !reader.IsEmptyElement())
+				{
+					skipDepth = 1;
+				}
+
+				break;
+			}
+			case XmlReader::Event::EndElement:
+				if (skipDepth > 0)
+					skipDepth--;
+				else if (!accumulatedGroups.empty())
+					accumulatedGroups.pop_back();
+				break;
+			case XmlReader::Event::End:
+				return true;
+			case XmlReader::Event::Error:
+				return false;
 			}
 		}
 	}
 
-	SvgNode* SvgParser::Parse(const std::filesystem::path& path)
+	void SvgParser::ParsePath(const SvgPathSource& source, SvgPath& path)
 	{
-		XMLDocument doc;
-		doc.LoadFile(path.string().c_str());
-
-		SvgSvg svg = SvgSvg();
-		// TODO: Query things like width, height, viewBox etc into SvgSvg class
-
-		SvgNode* root = new SvgNode(svg);
-		SvgGroup accumulatedGroup = SvgGroup::CreateDefault();
-		const XMLElement* rootElement = doc.FirstChildElement();
+		path.fill = source.fill;
+		path.stroke = source.stroke;
+		path.transform = source.transform;
 
-		IterateElements(rootElement, root, accumulatedGroup);
-		return root;
+		path.segments.clear();
+		ParsePathString(source.data, path.segments);
 	}
 
 }
@@ -1,23 +1,17 @@
 #pragma once
 
-#include <glm/glm.hpp>
-
-#include <tinyxml2.h>
+#include "Core/MappedFile.h"
 
-#include <cppcoro\generator.hpp>
+#include <glm/glm.hpp>
 
 #include <vector>
 #include <filesystem>
 #include <string_view>
 #include <optional>
+#include <span>
 
 namespace SvgRenderer {
 
-	enum class SvgNodeType
-	{
-		Svg = 0, Group, Path
-	};
-
 	enum class SvgFillRule
 	{
 		NonZero = 0, EvenOdd
@@ -43,10 +37,6 @@ namespace SvgRenderer {
 		bool hasStroke;
 	};
 
-	struct SvgSvg
-	{
-	};
-
 	struct SvgGroup
 	{
 		SvgFill fill;
@@ -128,25 +118,6 @@ namespace SvgRenderer {
 				: type(Type::CubicTo), as(SegmentUnion{ .cubicTo = cubicTo }) {}
 			Segment(const Close& close)
 				: type(Type::Close), as(SegmentUnion{ .close = close }) {}
-
-			~Segment()
-			{
-				switch (type)
-				{
-				case SvgPath::Segment::Type::MoveTo:
-					as.moveTo.~MoveTo();
-					break;
-				case SvgPath::Segment::Type::LineTo:
-					as.lineTo.~LineTo();
-					break;
-				case SvgPath::Segment::Type::QuadTo:
-					as.quadTo.~QuadTo();
-					break;
-				case SvgPath::Segment::Type::CubicTo:
-					as.cubicTo.~CubicTo();
-					break;
-				}
-			}
 		};
 
 		SvgFill fill;
@@ -156,64 +127,47 @@ namespace SvgRenderer {
 		std::vector<Segment> segments;
 	};
 
-	struct SvgNode
+	// Attribute of an element, both views point into the source document
+	struct SvgAttribute
 	{
-		SvgNodeType type;
-		union SvgNodeUnion
-		{
-			SvgSvg svg;
-			SvgGroup group;
-			SvgPath path;
-
-			~SvgNodeUnion() {}
-		} as;
-
-		std::vector<SvgNode*> children;
+		std::string_view name;
+		std::string_view value;
+	};
 
-		SvgNode(const SvgSvg& svg)
-			: type(SvgNodeType::Svg), as(SvgNodeUnion{ .svg = svg }) {}
-		SvgNode(const SvgGroup& group)
-			: type(SvgNodeType::Group), as(SvgNodeUnion{ .group = group }) {}
-		SvgNode(const SvgPath& path)
-			: type(SvgNodeType::Path), as(SvgNodeUnion{ .path = path }) {}
+	// Path found by SvgParser::Scan, the attributes of its groups are already applied,
+	// but its data are left unparsed, see SvgParser::ParsePath
+	struct SvgPathSource
+	{
+		SvgFill fill;
+		SvgStrokeFill stroke;
+		glm::mat3 transform;
 
-		~SvgNode()
-		{
-			for (SvgNode* node : children)
-				delete node;
+		std::string_view data; // Value of the d attribute, points into SvgDocument::file
+	};
 
-			switch (type)
-			{
-			case SvgNodeType::Svg:
-				as.svg.~SvgSvg();
-				break;
-			case SvgNodeType::Path:
-				as.path.~SvgPath();
-				break;
-			case SvgNodeType::Group:
-				as.group.~SvgGroup();
-				break;
-			}
-		}
+	struct SvgDocument
+	{
+		MappedFile file;
+		std::vector<SvgPathSource> paths; // Document order
 	};
 
 	class SvgParser
 	{
 	public:
-		static SvgNode* Parse(const std::filesystem::path& path);
+		// First pass of loading, walks the memory-mapped file and records every path with non-empty data.
+		// Only the elements are read, so it is cheap compared to parsing the data of the paths
+		static bool Scan(const std::filesystem::path& path, SvgDocument& document);
+		// Second pass of loading, the paths are independent and can be parsed from any thread
+		static void ParsePath(const SvgPathSource& source, SvgPath& path);
 	private:
 		static std::optional<SvgColor> ParseColor(std::string_view colorStr);
 		static SvgFillRule ParseFillRule(std::string_view str);
 		static std::optional<glm::mat3> ParseTransform(std::string_view str);
-		static std::vector<SvgPath::Segment> ParsePathString(std::string_view str);
-
-		static cppcoro::generator<float> ParseNumbersLine(std::string_view str);
-		static cppcoro::generator<const std::pair<char, std::vector<float>>&> ParseNumbersUntilOneOf(std::string_view str, std::string_view untilOneOf);
-
-		static SvgNode* ParseSvgGroup(const tinyxml2::XMLElement* element, const SvgGroup& previous);
-		static SvgNode* ParseSvgPath(const tinyxml2::XMLElement* element, const SvgGroup& group);
+		static void ParsePathString(std::string_view str, std::vector<SvgPath::Segment>& segments);
 
-		static void IterateElements(const tinyxml2::XMLElement* element, SvgNode* parent, SvgGroup accumulatedGroup);
+		static SvgGroup ParseSvgGroup(std::span<const SvgAttribute> attributes, const SvgGroup& previous);
+		// Returns false if the path does not carry any relevant information
+		static bool ParseSvgPath(std::span<const SvgAttribute> attributes, const SvgGroup& group, SvgPathSource& source);
 	};
 
-}
+}
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "TaskScheduler.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdlib>
+#include <string>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#elif defined(__linux__)
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+namespace SvgRenderer {
+
+	// Failed attempts to find work before an idle worker goes to sleep
+	constexpr uint32_t IDLE_ROUNDS = 64;
+	// Ranges per thread the loops are split into when no grain size is given
+	constexpr uint32_t RANGES_PER_THREAD = 8;
+
+	static void PinCurrentThread(uint32_t core)
+	{
+#ifdef _WIN32
+		SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << (core % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(core % CPU_SETSIZE, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+		// Not supported, the threads are left to the OS
+		(void)core;
+#endif
+	}
+
+	TaskSchedulerConfig TaskSchedulerConfig::FromEnvironment()
+	{
+		TaskSchedulerConfig config;
+		if (const char* threads = std::getenv("SR_THREADS"))
+		{
+			config.threadCount = static_cast<uint32_t>(std::strtoul(threads, nullptr, 10));
+		}
+
+		if (const char* pin = std::getenv("SR_PIN_THREADS"))
+		{
+			config.pinThreads = std::string(pin) == "1";
+		}
+
+		return config;
+	}
+
+	TaskScheduler::~TaskScheduler()
+	{
+		Shutdown();
+	}
+
+	void TaskScheduler::Init(const TaskSchedulerConfig& config)
+	{
+		SR_ASSERT(m_Queues.empty(), "Task scheduler is already initialized");
+
+		uint32_t threadCount = config.threadCount;
+		if (threadCount == 0)
+		{
+			threadCount = glm::max(std::thread::hardware_concurrency(), 1u);
+		}
+
+		m_Queues.resize(threadCount);
+		for (std::unique_ptr<Queue>& queue : m_Queues)
+		{
+			queue = std::make_unique<Queue>();
+		}
+
+		m_Exit = false;
+		s_Current = this;
+		s_ThreadIndex = 0;
+		if (config.pinThreads)
+		{
+			PinCurrentThread(0);
+		}
+
+		m_Workers.reserve(threadCount - 1);
+		for (uint32_t i = 1; i < threadCount; i++)
+		{
+			m_Workers.emplace_back(&TaskScheduler::WorkerLoop, this, i, config.pinThreads);
+		}
+
+		SR_INFO("Task scheduler: {0} threads{1}", threadCount, config.pinThreads ? ", pinned" : "");
+	}
+
+	void TaskScheduler::Shutdown()
+	{
+		if (m_Queues.empty())
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_SleepMutex);
+			m_Exit = true;
+		}
+		m_WakeUp.notify_all();
+
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+
+		m_Workers.clear();
+		m_Queues.clear();
+		if (s_Current == this)
+		{
+			s_Current = nullptr;
+		}
+	}
+
+	void TaskScheduler::Run(Job& job, uint32_t first, uint32_t last, uint32_t grainSize)
+	{
+		const uint32_t count = last - first;
+		job.grainSize = grainSize != 0 ? grainSize : glm::max(count / (GetThreadCount() * RANGES_PER_THREAD), 1u);
+		job.remaining.store(count, std::memory_order_relaxed);
+
+		const uint32_t threadIndex = s_ThreadIndex;
+		Execute(threadIndex, Range{ &job, first, last });
+
+		// Help with whatever is queued until the rest of the job is done by the others,
+		// this can be a range of an outer loop too, which is what makes the nesting work
+		while (job.remaining.load(std::memory_order_acquire) != 0)
+		{
+			Range range;
+			if (TryPop(threadIndex, range) || TrySteal(threadIndex, range))
+			{
+				Execute(threadIndex, range);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void TaskScheduler::Execute(uint32_t threadIndex, Range range)
+	{
+		Job& job = *range.job;
+		while (range.end - range.begin > job.grainSize)
+		{
+			const uint32_t middle = range.begin + (range.end - range.begin) / 2;
+			Push(threadIndex, Range{ &job, middle, range.end });
+			range.end = middle;
+		}
+
+		job.invoke(job.context, range.begin, range.end);
+		// Last access to the job, it can be gone once the count reaches 0
+		job.remaining.fetch_sub(range.end - range.begin, std::memory_order_acq_rel);
+	}
+
+	void TaskScheduler::Push(uint32_t threadIndex, const Range& range)
+	{
+		Queue& queue = *m_Queues[threadIndex];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.ranges.push_back(range);
+		}
+
+		// Together with the sleeping count incremented before the queued count is checked in WorkerLoop(),
+		// either the worker sees the new range or the range is followed by the notification
+		m_QueuedCount.fetch_add(1);
+		if (m_SleepingCount.load() > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_SleepMutex);
+			m_WakeUp.notify_one();
+		}
+	}
+
+	bool TaskScheduler::TryPop(uint32_t threadIndex, Range& range)
+	{
+		Queue& queue = *m_Queues[threadIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.ranges.empty())
+		{
+			return false;
+		}
+
+		// Newest range, the neighbour of the one just run
+		range = queue.ranges.back();
+		queue.ranges.pop_back();
+		m_QueuedCount.fetch_sub(1);
+		return true;
+	}
+
+	bool TaskScheduler::TrySteal(uint32_t threadIndex, Range& range)
+	{
+		const uint32_t threadCount = GetThreadCount();
+		for (uint32_t i = 1; i < threadCount; i++)
+		{
+			Queue& queue = *m_Queues[(threadIndex + i) % threadCount];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.ranges.empty())
+			{
+				continue;
+			}
+
+			// Oldest range, the largest one
+			range = queue.ranges.front();
+			queue.ranges.pop_front();
+			m_QueuedCount.fetch_sub(1);
+			return true;
+		}
+
+		return false;
+	}
+
+	void TaskScheduler::WorkerLoop(uint32_t threadIndex, bool pinThread)
+	{
+		s_Current = this;
+		s_ThreadIndex = threadIndex;
+		if (pinThread)
+		{
+			PinCurrentThread(threadIndex);
+		}
+
+		uint32_t idleRounds = 0;
+		while (!m_Exit.load(std::memory_order_acquire))
+		{
+			Range range;
+			if (TryPop(threadIndex, range) || TrySteal(threadIndex, range))
+			{
+				Execute(threadIndex, range);
+				idleRounds = 0;
+				continue;
+			}
+
+			if (++idleRounds < IDLE_ROUNDS)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_SleepMutex);
+			m_SleepingCount.fetch_add(1);
+			m_WakeUp.wait(lock, [this]() { return m_QueuedCount.load() > 0 || m_Exit.load(); });
+			m_SleepingCount.fetch_sub(1);
+			idleRounds = 0;
+		}
+	}
+
+}
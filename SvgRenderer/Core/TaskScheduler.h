@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SvgRenderer {
+
+	struct TaskSchedulerConfig
+	{
+		uint32_t threadCount = 0; // Including the thread calling Init(), 0 for one thread per logical core
+		bool pinThreads = false; // Pins the thread i to the logical core i
+
+		// Default config overridden by the SR_THREADS and SR_PIN_THREADS environment variables
+		static TaskSchedulerConfig FromEnvironment();
+	};
+
+	// Work-stealing scheduler for parallel loops over index ranges. Every thread has its own deque of ranges, it keeps
+	// splitting the range it runs in halves down to the grain size, pushes the upper halves and works on the lower one.
+	// Idle threads steal the oldest, so the largest, ranges of the others. The thread that called Init() is thread 0,
+	// and a thread waiting for its loop runs pending ranges in the meantime, so the loops can be nested
+	class TaskScheduler
+	{
+	public:
+		TaskScheduler() = default;
+		~TaskScheduler();
+
+		TaskScheduler(const TaskScheduler&) = delete;
+		TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+		void Init(const TaskSchedulerConfig& config = {});
+		void Shutdown();
+
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Queues.size()); }
+
+		// Calls func(i) for every i in [first, last) and returns when all the calls are done. grainSize is the smallest
+		// range that is split further, 0 picks it from the count. Runs sequentially on the threads of other schedulers
+		template <class Fn>
+		void ParallelFor(uint32_t first, uint32_t last, const Fn& func, uint32_t grainSize = 0)
+		{
+			if (first >= last)
+			{
+				return;
+			}
+
+			if (s_Current != this || GetThreadCount() == 1)
+			{
+				for (uint32_t i = first; i < last; i++)
+				{
+					func(i);
+				}
+
+				return;
+			}
+
+			Job job{
+				.invoke = &Invoke<Fn>,
+				.context = &func
+			};
+			Run(job, first, last, grainSize);
+		}
+	private:
+		struct Job
+		{
+			void (*invoke)(const void* context, uint32_t begin, uint32_t end);
+			const void* context;
+			uint32_t grainSize = 1;
+			std::atomic<uint32_t> remaining = 0; // Indices not run yet, the job is done at 0
+		};
+
+		struct Range
+		{
+			Job* job;
+			uint32_t begin;
+			uint32_t end;
+		};
+
+		// Own cache line, so the threads working on their deques do not slow down each other
+		struct alignas(64) Queue
+		{
+			std::mutex mutex;
+			std::deque<Range> ranges;
+		};
+
+		template <class Fn>
+		static void Invoke(const void* context, uint32_t begin, uint32_t end)
+		{
+			const Fn& func = *static_cast<const Fn*>(context);
+			for (uint32_t i = begin; i < end; i++)
+			{
+				func(i);
+			}
+		}
+
+		void Run(Job& job, uint32_t first, uint32_t last, uint32_t grainSize);
+		void Execute(uint32_t threadIndex, Range range);
+
+		void Push(uint32_t threadIndex, const Range& range);
+		bool TryPop(uint32_t threadIndex, Range& range);
+		bool TrySteal(uint32_t threadIndex, Range& range);
+
+		void WorkerLoop(uint32_t threadIndex, bool pinThread);
+	private:
+		std::vector<std::unique_ptr<Queue>> m_Queues;
+		std::vector<std::thread> m_Workers;
+
+		std::atomic<uint32_t> m_QueuedCount = 0;
+		std::atomic<uint32_t> m_SleepingCount = 0;
+		std::atomic<bool> m_Exit = false;
+		std::mutex m_SleepMutex;
+		std::condition_variable m_WakeUp;
+
+		// Scheduler and index of the calling thread, set for the threads of the scheduler only
+		inline static thread_local TaskScheduler* s_Current = nullptr;
+		inline static thread_local uint32_t s_ThreadIndex = 0;
+	};
+
+}
@@ -114,10 +114,17 @@ namespace SvgRenderer {
 		glfwTerminate();
 	}
 
-	void Window::OnUpdate()
+	void Window::OnUpdate(bool waitEvents)
 	{
 		glfwSwapBuffers(m_NativeWindow);
-		glfwPollEvents();
+		if (waitEvents)
+		{
+			glfwWaitEvents();
+		}
+		else
+		{
+			glfwPollEvents();
+		}
 	}
 
 	void Window::OnWindowShouldClose(GLFWwindow* window)
@@ -68,7 +68,8 @@ namespace SvgRenderer {
 	public:
 		Window(const WindowDesc& desc);
 
-		void OnUpdate();
+		// Presents the frame and processes the events, waitEvents blocks until there is at least one
+		void OnUpdate(bool waitEvents = false);
 
 		void Close();
 
@@ -5,8 +5,14 @@
 
 #include <glm/glm.hpp>
 
+#include <charconv>
+#include <cstring>
+
 using namespace SvgRenderer;
 
+// Upper bound of the headless image size, the image is kept in memory as RGBA
+static constexpr uint32_t MAX_IMAGE_SIZE = 32768;
+
 static bool IsValidChoice(const std::string& choice)
 {
 	if (choice.length() != 1)
@@ -22,12 +28,82 @@ static bool IsValidChoice(const std::string& choice)
 	return false;
 }
 
+static bool ParseCPUMode(const std::string& mode, CPUMode& cpuMode)
+{
+	if (mode == "seq")
+	{
+		cpuMode = CPUMode::Seq;
+		return true;
+	}
+
+	if (mode == "par")
+	{
+		cpuMode = CPUMode::Par;
+		return true;
+	}
+
+	if (mode == "binned")
+	{
+		cpuMode = CPUMode::Binned;
+		return true;
+	}
+
+	return false;
+}
+
+// The whole argument has to be the number
+static bool ParseImageSize(const char* arg, uint32_t& size)
+{
+	const char* last = arg + std::strlen(arg);
+	auto [end, error] = std::from_chars(arg, last, size);
+	return error == std::errc() && end == last && size > 0 && size <= MAX_IMAGE_SIZE;
+}
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: SvgRenderer <input.svg> <output.ppm|output.png> [width height [seq|par|binned]]\n"
+		<< "       SvgRenderer without arguments asks for an image and renders it in a window\n"
+		<< "Width and height are in pixels, from 1 to " << MAX_IMAGE_SIZE << "\n";
+}
+
 int main(int argc, char** argv)
 {
 	Filesystem::Init();
 	Log::Init();
 	SR_INFO("Initialized Log");
 
+	// Headless: SvgRenderer <input.svg> <output.ppm|output.png> [width height [seq|par|binned]],
+	// exits with 1 on bad arguments or when the image could not be rendered, so it can be used in batch jobs
+	if (argc >= 2)
+	{
+		if (argc == 2 || argc == 4 || argc > 6)
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		if (argc >= 5 && (!ParseImageSize(argv[3], Globals::WindowWidth) || !ParseImageSize(argv[4], Globals::WindowHeight)))
+		{
+			SR_ERROR("Invalid image size {0}x{1}", argv[3], argv[4]);
+			PrintUsage();
+			return 1;
+		}
+
+		CPUMode cpuMode = CPUMode::Par;
+		if (argc >= 6 && !ParseCPUMode(argv[5], cpuMode))
+		{
+			SR_ERROR("Invalid CPU mode {0}", argv[5]);
+			PrintUsage();
+			return 1;
+		}
+
+		Application& app = Application::Get();
+		const bool isRendered = app.InitHeadless(argv[1], argv[2], cpuMode) && app.Run();
+		app.Shutdown();
+
+		return isRendered ? 0 : 1;
+	}
+
 	std::string choice = "";
 	std::cout << "Select image to render:\n1) Tiger\n2) Paris\n3) World\n";
 
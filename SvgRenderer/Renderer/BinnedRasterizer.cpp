@@ -0,0 +1,278 @@
+#include "BinnedRasterizer.h"
+
+#include "Renderer/LineCells.h"
+
+namespace SvgRenderer {
+
+	// Point of the line p0 p1 at the y-coord
+	static glm::vec2 GetPointAtY(const glm::vec2& p0, const glm::vec2& p1, float y)
+	{
+		const float t = (y - p0.y) / (p1.y - p0.y);
+		return glm::vec2(p0.x + t * (p1.x - p0.x), y);
+	}
+
+	static uint8_t ResolveCoverage(float winding, uint32_t fillRule)
+	{
+		float coverage = glm::abs(winding);
+		if (fillRule == FILL_RULE_EVENODD)
+		{
+			coverage = 1.0f - glm::abs(glm::fract(coverage * 0.5f) * 2.0f - 1.0f);
+		}
+
+		return static_cast<uint8_t>(glm::min(coverage * 256.0f, 255.0f));
+	}
+
+	// Same blending as TileBuilder::Composite()
+	static void BlendPixel(uint8_t* pixel, const std::array<uint8_t, 4>& color, uint8_t coverage)
+	{
+		const float a = color[3] / 255.0f * coverage / 255.0f;
+		if (a <= 0.0f)
+		{
+			return;
+		}
+
+		pixel[0] = static_cast<uint8_t>(color[0] * a + pixel[0] * (1.0f - a) + 0.5f);
+		pixel[1] = static_cast<uint8_t>(color[1] * a + pixel[1] * (1.0f - a) + 0.5f);
+		pixel[2] = static_cast<uint8_t>(color[2] * a + pixel[2] * (1.0f - a) + 0.5f);
+		pixel[3] = static_cast<uint8_t>(255.0f * a + pixel[3] * (1.0f - a) + 0.5f);
+	}
+
+	// Coverage of a band, TILE_SIZE rows of width + 1 cells, the cell 0 of a row collects the heights of everything left of the screen
+	struct BandBuffer
+	{
+		std::vector<float> areas;
+		std::vector<float> heights;
+		int32_t stride = 0;
+		int32_t minCol = 0;
+		int32_t maxCol = 0;
+
+		void Resize(uint32_t width)
+		{
+			stride = static_cast<int32_t>(width) + 1;
+			areas.assign(static_cast<size_t>(stride) * TILE_SIZE, 0.0f);
+			heights.assign(static_cast<size_t>(stride) * TILE_SIZE, 0.0f);
+			minCol = stride;
+			maxCol = -1;
+		}
+
+		void Add(int32_t x, int32_t row, float area, float height)
+		{
+			// Cells right of the screen change nothing visible
+			if (row < 0 || row >= TILE_SIZE || x >= stride - 1)
+			{
+				return;
+			}
+
+			const int32_t col = glm::max(x + 1, 0);
+			if (x >= 0)
+			{
+				areas[row * stride + col] += area;
+			}
+
+			heights[row * stride + col] += height;
+			minCol = glm::min(minCol, col);
+			maxCol = glm::max(maxCol, col);
+		}
+	};
+
+	// Same walk over the cells as Rasterizer::LineTo(), with the band rows instead of the tiles
+	static void AccumulateLine(BandBuffer& buffer, int32_t top, const glm::vec2& last, const glm::vec2& point)
+	{
+		ForEachLineCell(last, point, [&buffer, top](int32_t x, int32_t y, float area, float height)
+		{
+			buffer.Add(x, y - top, area, height);
+		});
+	}
+
+	void BinnedRasterizer::Begin(uint32_t width, uint32_t height, uint32_t pathCount)
+	{
+		m_Width = width;
+		m_Height = height;
+		m_BandCount = (height + TILE_SIZE - 1) / TILE_SIZE;
+		m_PathBins.resize(pathCount);
+	}
+
+	void BinnedRasterizer::SetPathBands(uint32_t pathIndex, const BoundingBox& bbox, bool isVisible)
+	{
+		PathBins& bins = m_PathBins[pathIndex];
+		if (!isVisible || m_BandCount == 0)
+		{
+			bins.firstBand = 0;
+			bins.lastBand = -1;
+			return;
+		}
+
+		const int32_t lastBand = static_cast<int32_t>(m_BandCount) - 1;
+		bins.firstBand = glm::clamp(static_cast<int32_t>(glm::floor(bbox.min.y / TILE_SIZE)), 0, lastBand);
+		bins.lastBand = glm::clamp(static_cast<int32_t>(glm::floor(bbox.max.y / TILE_SIZE)), 0, lastBand);
+	}
+
+	void BinnedRasterizer::AllocateOffsets()
+	{
+		// Counts of the lines are stored one past the band, so the prefix sum in AllocateLines() turns them into the offsets in place
+		uint32_t offsetCount = 0;
+		for (PathBins& bins : m_PathBins)
+		{
+			bins.firstOffset = offsetCount;
+			offsetCount += bins.lastBand - bins.firstBand + 2;
+		}
+
+		m_Offsets.assign(offsetCount, 0);
+	}
+
+	void BinnedRasterizer::CountLine(uint32_t pathIndex, const glm::vec2& p0, const glm::vec2& p1)
+	{
+		const PathBins& bins = m_PathBins[pathIndex];
+		int32_t firstBand, lastBand;
+		if (!GetLineBands(bins, p0, p1, firstBand, lastBand))
+		{
+			return;
+		}
+
+		for (int32_t band = firstBand; band <= lastBand; band++)
+		{
+			m_Offsets[bins.firstOffset + band - bins.firstBand + 1]++;
+		}
+	}
+
+	void BinnedRasterizer::AllocateLines()
+	{
+		uint32_t lineCount = 0;
+		for (const PathBins& bins : m_PathBins)
+		{
+			const uint32_t bandCount = bins.lastBand - bins.firstBand + 1;
+			m_Offsets[bins.firstOffset] = lineCount;
+			for (uint32_t i = 1; i <= bandCount; i++)
+			{
+				m_Offsets[bins.firstOffset + i] += m_Offsets[bins.firstOffset + i - 1];
+			}
+
+			lineCount = m_Offsets[bins.firstOffset + bandCount];
+		}
+
+		m_Lines.resize(lineCount);
+		m_Cursors = m_Offsets;
+	}
+
+	void BinnedRasterizer::BinLine(uint32_t pathIndex, const glm::vec2& p0, const glm::vec2& p1)
+	{
+		const PathBins& bins = m_PathBins[pathIndex];
+		int32_t firstBand, lastBand;
+		if (!GetLineBands(bins, p0, p1, firstBand, lastBand))
+		{
+			return;
+		}
+
+		for (int32_t band = firstBand; band <= lastBand; band++)
+		{
+			// Both bands sharing a border clip to the same point on it, so the parts join exactly
+			const float top = static_cast<float>(band * TILE_SIZE);
+			const float bottom = top + TILE_SIZE;
+			auto ClipToBand = [&](const glm::vec2& point)
+			{
+				if (point.y < top)
+				{
+					return GetPointAtY(p0, p1, top);
+				}
+				else if (point.y > bottom)
+				{
+					return GetPointAtY(p0, p1, bottom);
+				}
+
+				return point;
+			};
+
+			m_Lines[m_Cursors[bins.firstOffset + band - bins.firstBand]++] = BinnedLine{ ClipToBand(p0), ClipToBand(p1) };
+		}
+	}
+
+	void BinnedRasterizer::RenderBand(uint32_t band, Image& target) const
+	{
+		thread_local BandBuffer buffer;
+		if (buffer.stride != static_cast<int32_t>(m_Width) + 1)
+		{
+			buffer.Resize(m_Width);
+		}
+
+		const int32_t top = static_cast<int32_t>(band * TILE_SIZE);
+		const int32_t rowCount = glm::min(static_cast<int32_t>(m_Height) - top, static_cast<int32_t>(TILE_SIZE));
+
+		for (uint32_t pathIndex = 0; pathIndex < m_PathBins.size(); pathIndex++)
+		{
+			const PathBins& bins = m_PathBins[pathIndex];
+			const int32_t bandIndex = static_cast<int32_t>(band);
+			if (bandIndex < bins.firstBand || bandIndex > bins.lastBand)
+			{
+				continue;
+			}
+
+			const uint32_t offset = bins.firstOffset + bandIndex - bins.firstBand;
+			if (m_Offsets[offset] == m_Offsets[offset + 1])
+			{
+				continue;
+			}
+
+			for (uint32_t i = m_Offsets[offset]; i < m_Offsets[offset + 1]; i++)
+			{
+				AccumulateLine(buffer, top, m_Lines[i].p0, m_Lines[i].p1);
+			}
+
+			if (buffer.maxCol < buffer.minCol)
+			{
+				continue;
+			}
+
+			// Pixel x is the cell x + 1, its coverage is its area plus the heights of all the cells left of it,
+			// and the cells are cleared on the way for the next path
+			const PathRender& path = Globals::AllPaths.paths[pathIndex];
+			for (int32_t row = 0; row < TILE_SIZE; row++)
+			{
+				float* areas = &buffer.areas[row * buffer.stride];
+				float* heights = &buffer.heights[row * buffer.stride];
+				uint8_t* pixels = row < rowCount ? target.GetRow(top + row) : nullptr;
+
+				float accum = 0.0f;
+				for (int32_t col = buffer.minCol; col <= buffer.maxCol; col++)
+				{
+					if (col > 0 && pixels != nullptr)
+					{
+						BlendPixel(pixels + (col - 1) * 4, path.color, ResolveCoverage(accum + areas[col], path.fillRule));
+					}
+
+					accum += heights[col];
+					areas[col] = 0.0f;
+					heights[col] = 0.0f;
+				}
+
+				// The path continues right of the screen, so its cells there were dropped
+				const uint8_t coverage = ResolveCoverage(accum, path.fillRule);
+				if (coverage != 0 && pixels != nullptr)
+				{
+					for (int32_t x = buffer.maxCol; x < static_cast<int32_t>(m_Width); x++)
+					{
+						BlendPixel(pixels + x * 4, path.color, coverage);
+					}
+				}
+			}
+
+			buffer.minCol = buffer.stride;
+			buffer.maxCol = -1;
+		}
+	}
+
+	bool BinnedRasterizer::GetLineBands(const PathBins& bins, const glm::vec2& p0, const glm::vec2& p1, int32_t& firstBand, int32_t& lastBand) const
+	{
+		const float minY = glm::min(p0.y, p1.y);
+		const float maxY = glm::max(p0.y, p1.y);
+		if (minY == maxY)
+		{
+			return false;
+		}
+
+		// A line ending on the border of a band does not reach into the next one
+		firstBand = glm::max(static_cast<int32_t>(glm::floor(minY / TILE_SIZE)), bins.firstBand);
+		lastBand = glm::min(static_cast<int32_t>(glm::ceil(maxY / TILE_SIZE)) - 1, bins.lastBand);
+		return firstBand <= lastBand;
+	}
+
+}
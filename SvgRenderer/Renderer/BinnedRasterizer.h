@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Renderer/Defs.h"
+#include "Renderer/Image.h"
+
+#include <vector>
+
+namespace SvgRenderer {
+
+	// Part of a flattened line inside one band
+	struct BinnedLine
+	{
+		glm::vec2 p0;
+		glm::vec2 p1;
+	};
+
+	// Screen-space alternative to the per path rasterization. The screen is split into bands, rows of tiles TILE_SIZE pixels high,
+	// the flattened lines are clipped to the bands they cross and binned per path and band, and every band is then rasterized
+	// and composited on its own, path by path in the draw order. A band only needs its own lines and a coverage buffer
+	// of its size, so the bands are balanced regardless of the sizes of the paths, and stay in the cache of the thread.
+	//
+	// Usage per frame: Begin(), SetPathBands() for every path, AllocateOffsets(), CountLine() for every line,
+	// AllocateLines(), BinLine() for every line, RenderBand() for every band. The lines of one path have to be counted
+	// and binned on one thread, different paths and bands can run in parallel
+	class BinnedRasterizer
+	{
+	public:
+		void Begin(uint32_t width, uint32_t height, uint32_t pathCount);
+
+		// Bands the path can touch, from its bounding box, nothing if it is not visible
+		void SetPathBands(uint32_t pathIndex, const BoundingBox& bbox, bool isVisible);
+		void AllocateOffsets();
+
+		void CountLine(uint32_t pathIndex, const glm::vec2& p0, const glm::vec2& p1);
+		void AllocateLines();
+		void BinLine(uint32_t pathIndex, const glm::vec2& p0, const glm::vec2& p1);
+
+		// Composites the paths into the rows of the band in the target, which has to be cleared before
+		void RenderBand(uint32_t band, Image& target) const;
+
+		uint32_t GetBandCount() const { return m_BandCount; }
+		uint32_t GetLineCount() const { return static_cast<uint32_t>(m_Lines.size()); }
+	private:
+		struct PathBins
+		{
+			int32_t firstBand;
+			int32_t lastBand; // Less than firstBand if the path is not binned
+			uint32_t firstOffset; // Offsets of the lines of the band firstBand + i are [offsets[firstOffset + i], offsets[firstOffset + i + 1])
+		};
+
+		// Bands of the line clamped to the bands of the path, false if the line is horizontal or outside of them
+		bool GetLineBands(const PathBins& bins, const glm::vec2& p0, const glm::vec2& p1, int32_t& firstBand, int32_t& lastBand) const;
+	private:
+		uint32_t m_Width = 0, m_Height = 0;
+		uint32_t m_BandCount = 0;
+
+		std::vector<PathBins> m_PathBins;
+		std::vector<uint32_t> m_Offsets;
+		std::vector<uint32_t> m_Cursors;
+		std::vector<BinnedLine> m_Lines;
+	};
+
+}
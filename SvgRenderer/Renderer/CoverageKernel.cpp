@@ -0,0 +1,201 @@
+#include "CoverageKernel.h"
+
+#include <glm/glm.hpp>
+
+// SR_DISABLE_SIMD leaves only the scalar path, the benchmarks check the vector paths against it
+#if defined(SR_DISABLE_SIMD)
+#elif defined(__AVX2__)
+	#define SR_AVX2
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define SR_SSE2
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+	#define SR_NEON
+	#include <arm_neon.h>
+#endif
+
+namespace SvgRenderer {
+
+	static_assert(TILE_SIZE == 16, "The kernels process a whole row of a tile at once");
+
+	// Increments are in 1/1000 of a pixel
+	constexpr float WINDING_SCALE = 1.0f / 1000.0f;
+
+#if defined(SR_AVX2)
+	// Splits 8 increments into the 8 areas and the 8 heights
+	static void Deinterleave(const Increment* increments, __m256i& areas, __m256i& heights)
+	{
+		const __m256 lo = _mm256_loadu_ps(reinterpret_cast<const float*>(increments));
+		const __m256 hi = _mm256_loadu_ps(reinterpret_cast<const float*>(increments + 4));
+		// The shuffle works within the 128-bit lanes, so the pixels end up as 0 1 4 5 2 3 6 7
+		areas = _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(lo, hi, 0b10001000)), 0b11011000);
+		heights = _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(lo, hi, 0b11011101)), 0b11011000);
+	}
+
+	static __m256i PrefixSum(__m256i values)
+	{
+		values = _mm256_add_epi32(values, _mm256_slli_si256(values, 4));
+		values = _mm256_add_epi32(values, _mm256_slli_si256(values, 8));
+		// Sum of the low lane added to the high one
+		return _mm256_add_epi32(values, _mm256_shuffle_epi32(_mm256_permute2x128_si256(values, values, 0x08), 0xFF));
+	}
+
+	static __m256i ToCoverage(__m256i values, bool evenOdd)
+	{
+		const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+		__m256 winding = _mm256_mul_ps(_mm256_and_ps(_mm256_cvtepi32_ps(values), absMask), _mm256_set1_ps(WINDING_SCALE));
+		if (evenOdd)
+		{
+			// The winding is not negative, so the truncation is the floor
+			const __m256 half = _mm256_mul_ps(winding, _mm256_set1_ps(0.5f));
+			const __m256 fraction = _mm256_sub_ps(half, _mm256_cvtepi32_ps(_mm256_cvttps_epi32(half)));
+			const __m256 distance = _mm256_and_ps(_mm256_sub_ps(_mm256_add_ps(fraction, fraction), _mm256_set1_ps(1.0f)), absMask);
+			winding = _mm256_sub_ps(_mm256_set1_ps(1.0f), distance);
+		}
+
+		return _mm256_cvttps_epi32(_mm256_min_ps(_mm256_mul_ps(winding, _mm256_set1_ps(256.0f)), _mm256_set1_ps(255.0f)));
+	}
+#elif defined(SR_SSE2)
+	// Splits 4 increments into the 4 areas and the 4 heights
+	static void Deinterleave(const Increment* increments, __m128i& areas, __m128i& heights)
+	{
+		const __m128 lo = _mm_loadu_ps(reinterpret_cast<const float*>(increments));
+		const __m128 hi = _mm_loadu_ps(reinterpret_cast<const float*>(increments + 2));
+		areas = _mm_castps_si128(_mm_shuffle_ps(lo, hi, 0b10001000));
+		heights = _mm_castps_si128(_mm_shuffle_ps(lo, hi, 0b11011101));
+	}
+
+	static __m128i PrefixSum(__m128i values)
+	{
+		values = _mm_add_epi32(values, _mm_slli_si128(values, 4));
+		return _mm_add_epi32(values, _mm_slli_si128(values, 8));
+	}
+
+	static __m128i ToCoverage(__m128i values, bool evenOdd)
+	{
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		__m128 winding = _mm_mul_ps(_mm_and_ps(_mm_cvtepi32_ps(values), absMask), _mm_set1_ps(WINDING_SCALE));
+		if (evenOdd)
+		{
+			// The winding is not negative, so the truncation is the floor
+			const __m128 half = _mm_mul_ps(winding, _mm_set1_ps(0.5f));
+			const __m128 fraction = _mm_sub_ps(half, _mm_cvtepi32_ps(_mm_cvttps_epi32(half)));
+			const __m128 distance = _mm_and_ps(_mm_sub_ps(_mm_add_ps(fraction, fraction), _mm_set1_ps(1.0f)), absMask);
+			winding = _mm_sub_ps(_mm_set1_ps(1.0f), distance);
+		}
+
+		return _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(winding, _mm_set1_ps(256.0f)), _mm_set1_ps(255.0f)));
+	}
+#elif defined(SR_NEON)
+	static int32x4_t PrefixSum(int32x4_t values)
+	{
+		const int32x4_t zero = vdupq_n_s32(0);
+		values = vaddq_s32(values, vextq_s32(zero, values, 3));
+		return vaddq_s32(values, vextq_s32(zero, values, 2));
+	}
+
+	static int16x4_t ToCoverage(int32x4_t values, bool evenOdd)
+	{
+		float32x4_t winding = vmulq_n_f32(vabsq_f32(vcvtq_f32_s32(values)), WINDING_SCALE);
+		if (evenOdd)
+		{
+			// The winding is not negative, so the truncation is the floor
+			const float32x4_t half = vmulq_n_f32(winding, 0.5f);
+			const float32x4_t fraction = vsubq_f32(half, vcvtq_f32_s32(vcvtq_s32_f32(half)));
+			winding = vsubq_f32(vdupq_n_f32(1.0f), vabsq_f32(vsubq_f32(vaddq_f32(fraction, fraction), vdupq_n_f32(1.0f))));
+		}
+
+		return vqmovn_s32(vcvtq_s32_f32(vminq_f32(vmulq_n_f32(winding, 256.0f), vdupq_n_f32(255.0f))));
+	}
+#else
+	static float ToCoverage(int32_t value, bool evenOdd)
+	{
+		float winding = glm::abs(static_cast<float>(value)) * WINDING_SCALE;
+		if (evenOdd)
+		{
+			winding = 1.0f - glm::abs(glm::fract(winding * 0.5f) * 2.0f - 1.0f);
+		}
+
+		return glm::min(winding * 256.0f, 255.0f);
+	}
+#endif
+
+	// The coverage of the pixel x is carry + (heights[0] + ... + heights[x]) - heights[x] + areas[x],
+	// so the row is a prefix sum of the heights, with the last element of the sum carried to the next tile
+	void AccumulateCoverage(const Increment* increments, int32_t* carry, uint32_t fillRule, uint8_t* dst, size_t stride)
+	{
+		const bool evenOdd = fillRule == FILL_RULE_EVENODD;
+		for (uint32_t y = 0; y < TILE_SIZE; y++)
+		{
+			const Increment* row = increments + y * TILE_SIZE;
+			uint8_t* out = dst + y * stride;
+
+#if defined(SR_AVX2)
+			__m256i areas0, heights0, areas1, heights1;
+			Deinterleave(row, areas0, heights0);
+			Deinterleave(row + 8, areas1, heights1);
+
+			const __m256i accum = _mm256_set1_epi32(carry[y]);
+			const __m256i sums0 = _mm256_add_epi32(PrefixSum(heights0), accum);
+			const __m256i sums1 = _mm256_add_epi32(PrefixSum(heights1), _mm256_permutevar8x32_epi32(sums0, _mm256_set1_epi32(7)));
+
+			const __m256i coverage0 = ToCoverage(_mm256_add_epi32(_mm256_sub_epi32(sums0, heights0), areas0), evenOdd);
+			const __m256i coverage1 = ToCoverage(_mm256_add_epi32(_mm256_sub_epi32(sums1, heights1), areas1), evenOdd);
+
+			// Packing works within the 128-bit lanes, so the halves are packed as SSE registers to keep the order
+			const __m128i words0 = _mm_packs_epi32(_mm256_castsi256_si128(coverage0), _mm256_extracti128_si256(coverage0, 1));
+			const __m128i words1 = _mm_packs_epi32(_mm256_castsi256_si128(coverage1), _mm256_extracti128_si256(coverage1, 1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(words0, words1));
+
+			carry[y] = _mm256_extract_epi32(sums1, 7);
+#elif defined(SR_SSE2)
+			__m128i coverage[4];
+			__m128i accum = _mm_set1_epi32(carry[y]);
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				__m128i areas, heights;
+				Deinterleave(row + x * 4, areas, heights);
+
+				const __m128i sums = _mm_add_epi32(PrefixSum(heights), accum);
+				coverage[x] = ToCoverage(_mm_add_epi32(_mm_sub_epi32(sums, heights), areas), evenOdd);
+				accum = _mm_shuffle_epi32(sums, 0xFF);
+			}
+
+			const __m128i words0 = _mm_packs_epi32(coverage[0], coverage[1]);
+			const __m128i words1 = _mm_packs_epi32(coverage[2], coverage[3]);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(words0, words1));
+
+			carry[y] = _mm_cvtsi128_si32(accum);
+#elif defined(SR_NEON)
+			int16x4_t coverage[4];
+			int32x4_t accum = vdupq_n_s32(carry[y]);
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				// Loads 4 increments as the 4 areas and the 4 heights
+				const int32x4x2_t values = vld2q_s32(reinterpret_cast<const int32_t*>(row + x * 4));
+
+				const int32x4_t sums = vaddq_s32(PrefixSum(values.val[1]), accum);
+				coverage[x] = ToCoverage(vaddq_s32(vsubq_s32(sums, values.val[1]), values.val[0]), evenOdd);
+				accum = vdupq_n_s32(vgetq_lane_s32(sums, 3));
+			}
+
+			const uint8x8_t bytes0 = vqmovun_s16(vcombine_s16(coverage[0], coverage[1]));
+			const uint8x8_t bytes1 = vqmovun_s16(vcombine_s16(coverage[2], coverage[3]));
+			vst1q_u8(out, vcombine_u8(bytes0, bytes1));
+
+			carry[y] = vgetq_lane_s32(accum, 0);
+#else
+			int32_t accum = carry[y];
+			for (uint32_t x = 0; x < TILE_SIZE; x++)
+			{
+				out[x] = static_cast<uint8_t>(ToCoverage(accum + row[x].area, evenOdd));
+				accum += row[x].height;
+			}
+
+			carry[y] = accum;
+#endif
+		}
+	}
+
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Renderer/Defs.h"
+
+namespace SvgRenderer {
+
+	// Turns the increments of one tile into 8-bit coverage, min(|accum + area| * 256, 255) for every pixel, where accum
+	// is the sum of the heights to the left of the pixel, with the winding folded to [0, 1] first for FILL_RULE_EVENODD.
+	// The sums stay in the fixed point of the increments, carry holds TILE_SIZE of them, the coverage entering each row
+	// from the left, and gets the coverage leaving it.
+	// Row y of the tile is written to dst + y * stride, 16 pixels of a row at a time with AVX2, SSE2 or NEON
+	void AccumulateCoverage(const Increment* increments, int32_t* carry, uint32_t fillRule, uint8_t* dst, size_t stride);
+
+}
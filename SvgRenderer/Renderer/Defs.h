@@ -1,11 +1,12 @@
 #pragma once
 
 #include "Utils/BoundingBox.h"
+#include "Utils/ChunkedPool.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include <execution>
+#include <span>
 
 namespace SvgRenderer {
 
@@ -14,10 +15,8 @@ namespace SvgRenderer {
 	#define QUAD_TO 2
 	#define CUBIC_TO 3
 
-	#define GET_CMD_PATH_INDEX(value) (value >> 8)
-	#define GET_CMD_TYPE(value) (value & 0x000000FF)
-	#define MAKE_CMD_PATH_INDEX(value, index) ((index << 8) | (value & 0x000000FF))
-	#define MAKE_CMD_TYPE(value, type) (type | (value & 0xFFFFFF00))
+	#define FILL_RULE_NONZERO 0
+	#define FILL_RULE_EVENODD 1
 
 	constexpr float TOLERANCE = 0.05f; // Quality of flattening
 	constexpr int8_t TILE_SIZE = 16;
@@ -43,26 +42,95 @@ namespace SvgRenderer {
 		uint32_t startSpanQuadIndex;
 		uint32_t startTileQuadIndex;
 		bool isBboxVisible;
-		uint32_t _pad0;
+		uint32_t fillRule; // FILL_RULE_NONZERO or FILL_RULE_EVENODD
 		uint32_t _pad1;
 		uint32_t _pad2;
 	};
 
-	struct PathRenderCmd
+	// Whether the pixels with the winding are filled
+	constexpr bool IsInside(int32_t winding, uint32_t fillRule)
 	{
-		uint32_t pathIndexCmdType; // 16 bits pathIndex, 8 bits curve type, 8 bits unused, GET_CMD_PATH_INDEX, GET_CMD_TYPE, MAKE_CMD_PATH_INDEX, MAKE_CMD_TYPE
-		uint32_t startIndexSimpleCommands;
-		uint32_t endIndexSimpleCommands;
-		uint32_t _pad0;
-		std::array<glm::vec2, 4> points; // Maybe unused, but maximum 3 points for cubicTo
-		std::array<glm::vec2, 4> transformedPoints; // Maybe unused, but maximum 3 points for cubicTo
+		return fillRule == FILL_RULE_EVENODD ? (winding & 1) != 0 : winding != 0;
+	}
+
+	constexpr uint32_t GetCmdPointCount(uint32_t type)
+	{
+		return type == QUAD_TO ? 2 : (type == CUBIC_TO ? 3 : 1);
+	}
+
+	struct SimpleCommandsRange
+	{
+		uint32_t start;
+		uint32_t end;
+		uint32_t segmentCount; // Lines of the command before clipping, computed by pre-flatten and reused by flatten
+	};
+
+	// Commands of all the paths as separate streams, every step reads only the streams it needs.
+	// Points of the commands are stored back to back, so the last point of the previous command
+	// is always just before the first point of the command
+	struct CommandsContainer
+	{
+		std::vector<uint8_t> types;
+		std::vector<uint32_t> pathIndices;
+		std::vector<uint32_t> pointsOffsets = { 0 }; // Points of the command i are [pointsOffsets[i], pointsOffsets[i + 1])
+		std::vector<SimpleCommandsRange> simpleCommandRanges; // Simple commands of the command, filled by pre-flatten
+		std::vector<glm::vec2> points;
+		std::vector<glm::vec2> transformedPoints; // Same indices as points
+
+		uint32_t Size() const { return static_cast<uint32_t>(types.size()); }
+
+		void Add(uint32_t type, uint32_t pathIndex, const glm::vec2* cmdPoints)
+		{
+			types.push_back(static_cast<uint8_t>(type));
+			pathIndices.push_back(pathIndex);
+			simpleCommandRanges.push_back(SimpleCommandsRange{ 0, 0, 0 });
+			points.insert(points.end(), cmdPoints, cmdPoints + GetCmdPointCount(type));
+			pointsOffsets.push_back(static_cast<uint32_t>(points.size()));
+			transformedPoints.resize(points.size());
+		}
+
+		// Makes room for commands and points that are then written in place, possibly in parallel
+		void Resize(uint32_t cmdCount, uint32_t pointCount)
+		{
+			types.resize(cmdCount);
+			pathIndices.resize(cmdCount);
+			pointsOffsets.resize(cmdCount + 1);
+			simpleCommandRanges.resize(cmdCount, SimpleCommandsRange{ 0, 0, 0 });
+			points.resize(pointCount);
+			transformedPoints.resize(pointCount);
+		}
+
+		const glm::vec2* GetTransformedPoints(uint32_t cmdIndex) const { return &transformedPoints[pointsOffsets[cmdIndex]]; }
+	};
+
+	// Read-only inputs of the GPU pipeline, the arrays are either in Globals::AllPaths or in a memory-mapped SceneCache
+	struct SceneView
+	{
+		std::span<const PathRender> paths;
+		std::span<const uint8_t> cmdTypes;
+		std::span<const uint32_t> cmdPathIndices;
+		std::span<const uint32_t> cmdPointsOffsets;
+		std::span<const glm::vec2> points;
+
+		uint32_t GetCmdCount() const { return static_cast<uint32_t>(cmdPathIndices.size()); }
 	};
 
 	struct PathsContainer
 	{
 		std::vector<PathRender> paths;
-		std::vector<PathRenderCmd> commands;
+		CommandsContainer commands;
 		std::vector<SimpleCommand> simpleCommands;
+
+		SceneView GetView() const
+		{
+			return SceneView{
+				.paths = paths,
+				.cmdTypes = commands.types,
+				.cmdPathIndices = commands.pathIndices,
+				.cmdPointsOffsets = commands.pointsOffsets,
+				.points = commands.points
+			};
+		}
 	};
 
 	struct Increment
@@ -71,17 +139,31 @@ namespace SvgRenderer {
 		int32_t height;
 	};
 
-	struct Tile
+	using TileIncrements = std::array<Increment, TILE_SIZE * TILE_SIZE>;
+	using TileIncrementsPool = ChunkedPool<TileIncrements>;
+
+	struct Tile // Only the header is dense, increments are allocated on the first touch
 	{
-		int32_t winding;
-		uint32_t nextTileIndex;
-		bool hasIncrements;
-		std::array<Increment, TILE_SIZE * TILE_SIZE> increments;
+		int32_t winding = 0;
+		uint32_t nextTileIndex = std::numeric_limits<uint32_t>::max();
+		uint32_t incrementsIndex = TileIncrementsPool::INVALID_INDEX; // Index into TilesContainer::increments
+
+		bool HasIncrements() const { return incrementsIndex != TileIncrementsPool::INVALID_INDEX; }
 	};
 
 	struct TilesContainer
 	{
 		std::vector<Tile> tiles;
+		TileIncrementsPool increments;
+	};
+
+	// For every 16x16 screen tile, index of the topmost path that covers the whole tile with an opaque span.
+	// Path 0 is drawn first and cannot hide anything, so 0 also means there is no occluder
+	struct OcclusionContainer
+	{
+		std::vector<uint32_t> occluders;
+		uint32_t tileCountX = 0;
+		uint32_t tileCountY = 0;
 	};
 
 	class Globals
@@ -94,7 +176,10 @@ namespace SvgRenderer {
 		inline static uint32_t CommandsCount = 0;
 
 		inline static PathsContainer AllPaths;
+		inline static SceneView Scene; // What the GPU pipeline uploads, set by Application::LoadScene
+		inline static uint32_t SceneVersion = 0; // Incremented whenever the paths change, so the frames know they have to be rendered again
 		inline static TilesContainer Tiles;
+		inline static OcclusionContainer Occlusion;
 	};
 
 }
@@ -5,6 +5,8 @@
 
 #include <glm/gtx/compatibility.hpp>
 
+#include <algorithm>
+
 namespace SvgRenderer::Flattening {
 
 	static bool IsPointInsideViewSpace(const glm::vec2& v)
@@ -108,31 +110,46 @@ namespace SvgRenderer::Flattening {
 		return IsLineInsideViewSpace(bbox.min, bbox.max) || IsLineInsideViewSpace(p1, p2);
 	}
 
-	BoundingBox FlattenIntoArray(const PathRenderCmd& cmd, glm::vec2 last, float tolerance)
+	// Wang's formula, the number of lines that keeps the flattened curve within the tolerance.
+	// Pre-flatten stores it in the range of the command, so flatten does not compute it again
+	static uint32_t GetQuadSegmentCount(const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& p2, float tolerance)
+	{
+		const float dd = glm::length(p0 - 2.0f * p1 + p2);
+		return glm::max(static_cast<uint32_t>(glm::ceil(glm::sqrt(dd / (4.0f * tolerance)))), 1u);
+	}
+
+	static uint32_t GetCubicSegmentCount(const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& p2, const glm::vec2& p3, float tolerance)
+	{
+		const float dd = glm::max(glm::length(p0 - 2.0f * p1 + p2), glm::length(p1 - 2.0f * p2 + p3));
+		return glm::max(static_cast<uint32_t>(glm::ceil(glm::sqrt(0.75f * dd / tolerance))), 1u);
+	}
+
+	BoundingBox FlattenIntoArray(uint32_t cmdIndex, glm::vec2 last, float tolerance)
 	{
-		uint32_t index = cmd.startIndexSimpleCommands;
+		uint32_t index = Globals::AllPaths.commands.simpleCommandRanges[cmdIndex].start;
+		const glm::vec2* points = Globals::AllPaths.commands.GetTransformedPoints(cmdIndex);
 
 		BoundingBox bbox;
-		uint32_t pathType = GET_CMD_TYPE(cmd.pathIndexCmdType);
+		uint32_t pathType = Globals::AllPaths.commands.types[cmdIndex];
 		switch (pathType)
 		{
 		case MOVE_TO:
 		{
-			Globals::AllPaths.simpleCommands[index] = SimpleCommand{ .type = MOVE_TO, .point = cmd.transformedPoints[0] };
-			bbox.AddPoint(cmd.transformedPoints[0]);
+			Globals::AllPaths.simpleCommands[index] = SimpleCommand{ .type = MOVE_TO, .point = points[0] };
+			bbox.AddPoint(points[0]);
 			break;
 		}
 		case LINE_TO:
 		{
-			const glm::vec2& p = cmd.transformedPoints[0];
+			const glm::vec2& p = points[0];
 			Globals::AllPaths.simpleCommands[index] = SimpleCommand{ .type = LINE_TO, .point = p };
 			bbox.AddPoint(p);
 			break;
 		}
 		case QUAD_TO:
 		{
-			const glm::vec2& p1 = cmd.transformedPoints[0];
-			const glm::vec2& p2 = cmd.transformedPoints[1];
+			const glm::vec2& p1 = points[0];
+			const glm::vec2& p2 = points[1];
 
 			bool isVisible = IsLineInsideViewSpace(last, p1) || IsLineInsideViewSpace(p1, p2) || IsLineInsideViewSpace(p2, last);
 			if (!isVisible)
@@ -141,11 +158,10 @@ namespace SvgRenderer::Flattening {
 				break;
 			}
 
-			const float dt = glm::sqrt(((4.0f * tolerance) / glm::length(last - 2.0f * p1 + p2)));
-			float t = 0.0f;
-			while (t < 1.0f)
+			const uint32_t segmentCount = GetQuadSegmentCount(last, p1, p2, tolerance);
+			for (uint32_t i = 1; i <= segmentCount; i++)
 			{
-				t = glm::min(t + dt, 1.0f);
+				const float t = static_cast<float>(i) / static_cast<float>(segmentCount);
 				const glm::vec2 p01 = glm::lerp(last, p1, t);
 				const glm::vec2 p12 = glm::lerp(p1, p2, t);
 				const glm::vec2 p1 = glm::lerp(p01, p12, t);
@@ -158,9 +174,9 @@ namespace SvgRenderer::Flattening {
 		}
 		case CUBIC_TO:
 		{
-			const glm::vec2& p1 = cmd.transformedPoints[0];
-			const glm::vec2& p2 = cmd.transformedPoints[1];
-			const glm::vec2& p3 = cmd.transformedPoints[2];
+			const glm::vec2& p1 = points[0];
+			const glm::vec2& p2 = points[1];
+			const glm::vec2& p3 = points[2];
 
 			bool isVisible = IsLineInsideViewSpace(last, p1) || IsLineInsideViewSpace(p1, p2) || IsLineInsideViewSpace(p2, p3) || IsLineInsideViewSpace(p3, last);
 			if (!isVisible)
@@ -169,15 +185,10 @@ namespace SvgRenderer::Flattening {
 				break;
 			}
 
-			const glm::vec2 a = -1.0f * last + 3.0f * p1 - 3.0f * p2 + p3;
-			const glm::vec2 b = 3.0f * (last - 2.0f * p1 + p2);
-			const float conc = glm::max(glm::length(b), glm::length(a + b));
-			const float dt = glm::sqrt((glm::sqrt(8.0f) * tolerance) / conc);
-			float t = 0.0f;
-
-			while (t < 1.0f)
+			const uint32_t segmentCount = GetCubicSegmentCount(last, p1, p2, p3, tolerance);
+			for (uint32_t i = 1; i <= segmentCount; i++)
 			{
-				t = glm::min(t + dt, 1.0f);
+				const float t = static_cast<float>(i) / static_cast<float>(segmentCount);
 				const glm::vec2 p01 = glm::lerp(last, p1, t);
 				const glm::vec2 p12 = glm::lerp(p1, p2, t);
 				const glm::vec2 p23 = glm::lerp(p2, p3, t);
@@ -631,19 +642,57 @@ namespace SvgRenderer::Flattening {
 		}
 	}
 
-	uint32_t CalculateNumberOfSimpleCommands(uint32_t cmdIndex, glm::vec2 last, float tolerance)
+	// Curve points are evaluated the same way by pre-flatten and flatten, so both agree on the clipping
+	static glm::vec2 EvaluateQuad(const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& p2, float t)
+	{
+		const glm::vec2 p01 = glm::lerp(p0, p1, t);
+		const glm::vec2 p12 = glm::lerp(p1, p2, t);
+		return glm::lerp(p01, p12, t);
+	}
+
+	static glm::vec2 EvaluateCubic(const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& p2, const glm::vec2& p3, float t)
+	{
+		const glm::vec2 p01 = glm::lerp(p0, p1, t);
+		const glm::vec2 p12 = glm::lerp(p1, p2, t);
+		const glm::vec2 p23 = glm::lerp(p2, p3, t);
+		const glm::vec2 p012 = glm::lerp(p01, p12, t);
+		const glm::vec2 p123 = glm::lerp(p12, p23, t);
+		return glm::lerp(p012, p123, t);
+	}
+
+	// The flattened points of a curve lie in the convex hull of its control points, so if all of them are inside
+	// the view space, with a margin for the rounding of the evaluation, none of the lines is clipped
+	static bool IsCurveInsideViewSpace(const glm::vec2& p0, const glm::vec2* points, uint32_t pointCount)
+	{
+		auto IsInside = [](const glm::vec2& p)
+		{
+			return p.x >= 0.0f && p.x <= Globals::WindowWidth - 1.0f && p.y >= 0.0f && p.y <= Globals::WindowHeight - 1.0f;
+		};
+
+		return IsInside(p0) && std::all_of(points, points + pointCount, IsInside);
+	}
+
+	// Every line of an unclipped curve is one LINE_TO, only the first one starts with a MOVE_TO after a move,
+	// unless it is degenerate, so just the first point is needed
+	static uint32_t GetUnclippedNumberOfSimpleCommands(uint32_t segmentCount, const glm::vec2& last, const glm::vec2& first, bool wasLastMove)
+	{
+		return segmentCount + (wasLastMove && !IsEqual(last, first) ? 1 : 0);
+	}
+
+	uint32_t CalculateNumberOfSimpleCommands(uint32_t cmdIndex, glm::vec2 last, float tolerance, uint32_t& segmentCount)
 	{
-		const PathRenderCmd& cmd = Globals::AllPaths.commands[cmdIndex];
-		uint32_t cmdType = GET_CMD_TYPE(cmd.pathIndexCmdType);
+		const CommandsContainer& commands = Globals::AllPaths.commands;
+		uint32_t cmdType = commands.types[cmdIndex];
 		if (cmdType == MOVE_TO)
 		{
+			segmentCount = 0;
 			return 0;
 		}
 
-		uint32_t pathIndex = GET_CMD_PATH_INDEX(cmd.pathIndexCmdType);
-		const PathRender& path = Globals::AllPaths.paths[pathIndex];
+		const glm::vec2* points = commands.GetTransformedPoints(cmdIndex);
+		const PathRender& path = Globals::AllPaths.paths[commands.pathIndices[cmdIndex]];
 		bool wasLastMove = false;
-		if (path.startCmdIndex == cmdIndex || GET_CMD_TYPE(Globals::AllPaths.commands[cmdIndex - 1].pathIndexCmdType) == MOVE_TO)
+		if (path.startCmdIndex == cmdIndex || commands.types[cmdIndex - 1] == MOVE_TO)
 		{
 			wasLastMove = true;
 		}
@@ -655,25 +704,27 @@ namespace SvgRenderer::Flattening {
 			break;
 		case LINE_TO:
 		{
-			glm::vec2 point = cmd.transformedPoints[0];
+			glm::vec2 point = points[0];
+			segmentCount = 1;
 			return HandleLineNumberOfSimpleCommands(last, point, wasLastMove);
 		}
 		case QUAD_TO:
 		{
-			const glm::vec2& p1 = cmd.transformedPoints[0];
-			const glm::vec2& p2 = cmd.transformedPoints[1];
+			const glm::vec2& p1 = points[0];
+			const glm::vec2& p2 = points[1];
 
-			glm::vec2 lastFLattened = last;
+			segmentCount = GetQuadSegmentCount(last, p1, p2, tolerance);
+			if (IsCurveInsideViewSpace(last, points, 2))
+			{
+				return GetUnclippedNumberOfSimpleCommands(segmentCount, last, EvaluateQuad(last, p1, p2, 1.0f / static_cast<float>(segmentCount)), wasLastMove);
+			}
 
-			const float dt = glm::sqrt(((4.0f * tolerance) / glm::length(last - 2.0f * p1 + p2)));
-			float t = 0.0f;
+			glm::vec2 lastFLattened = last;
 			uint32_t count = 0;
-			while (t < 1.0f)
+			for (uint32_t i = 1; i <= segmentCount; i++)
 			{
-				t = glm::min(t + dt, 1.0f);
-				const glm::vec2 p01 = glm::lerp(last, p1, t);
-				const glm::vec2 p12 = glm::lerp(p1, p2, t);
-				const glm::vec2 point = glm::lerp(p01, p12, t);
+				const float t = static_cast<float>(i) / static_cast<float>(segmentCount);
+				const glm::vec2 point = EvaluateQuad(last, p1, p2, t);
 
 				count += HandleLineNumberOfSimpleCommands(lastFLattened, point, wasLastMove);
 				lastFLattened = point;
@@ -684,28 +735,22 @@ namespace SvgRenderer::Flattening {
 		}
 		case CUBIC_TO:
 		{
-			const glm::vec2& p1 = cmd.transformedPoints[0];
-			const glm::vec2& p2 = cmd.transformedPoints[1];
-			const glm::vec2& p3 = cmd.transformedPoints[2];
+			const glm::vec2& p1 = points[0];
+			const glm::vec2& p2 = points[1];
+			const glm::vec2& p3 = points[2];
 
-			glm::vec2 lastFLattened = last;
-
-			const glm::vec2 a = -1.0f * last + 3.0f * p1 - 3.0f * p2 + p3;
-			const glm::vec2 b = 3.0f * (last - 2.0f * p1 + p2);
-			const float conc = glm::max(glm::length(b), glm::length(a + b));
-			const float dt = glm::sqrt((glm::sqrt(8.0f) * tolerance) / conc);
+			segmentCount = GetCubicSegmentCount(last, p1, p2, p3, tolerance);
+			if (IsCurveInsideViewSpace(last, points, 3))
+			{
+				return GetUnclippedNumberOfSimpleCommands(segmentCount, last, EvaluateCubic(last, p1, p2, p3, 1.0f / static_cast<float>(segmentCount)), wasLastMove);
+			}
 
-			float t = 0.0f;
+			glm::vec2 lastFLattened = last;
 			uint32_t count = 0;
-			while (t < 1.0f)
+			for (uint32_t i = 1; i <= segmentCount; i++)
 			{
-				t = glm::min(t + dt, 1.0f);
-				const glm::vec2 p01 = glm::lerp(last, p1, t);
-				const glm::vec2 p12 = glm::lerp(p1, p2, t);
-				const glm::vec2 p23 = glm::lerp(p2, p3, t);
-				const glm::vec2 p012 = glm::lerp(p01, p12, t);
-				const glm::vec2 p123 = glm::lerp(p12, p23, t);
-				const glm::vec2 point = glm::lerp(p012, p123, t);
+				const float t = static_cast<float>(i) / static_cast<float>(segmentCount);
+				const glm::vec2 point = EvaluateCubic(last, p1, p2, p3, t);
 
 				count += HandleLineNumberOfSimpleCommands(lastFLattened, point, wasLastMove);
 				lastFLattened = point;
@@ -719,22 +764,25 @@ namespace SvgRenderer::Flattening {
 			break;
 		}
 
+		segmentCount = 0;
 		return 0;
 	}
 
-	void Flatten(uint32_t cmdIndex, const glm::vec2& last, float tolerance)
+	void Flatten(uint32_t cmdIndex, const glm::vec2& last)
 	{
-		const PathRenderCmd& cmd = Globals::AllPaths.commands[cmdIndex];
-		uint32_t cmdType = GET_CMD_TYPE(cmd.pathIndexCmdType);
+		const CommandsContainer& commands = Globals::AllPaths.commands;
+		uint32_t cmdType = commands.types[cmdIndex];
 		if (cmdType == MOVE_TO)
 		{
 			return;
 		}
 
-		uint32_t pathIndex = GET_CMD_PATH_INDEX(cmd.pathIndexCmdType);
-		const PathRender& path = Globals::AllPaths.paths[pathIndex];
+		const glm::vec2* points = commands.GetTransformedPoints(cmdIndex);
+		const SimpleCommandsRange& range = commands.simpleCommandRanges[cmdIndex];
+		const uint32_t startIndexSimpleCommands = range.start;
+		const PathRender& path = Globals::AllPaths.paths[commands.pathIndices[cmdIndex]];
 		bool wasLastMove = false;
-		if (path.startCmdIndex == cmdIndex || GET_CMD_TYPE(Globals::AllPaths.commands[cmdIndex - 1].pathIndexCmdType) == MOVE_TO)
+		if (path.startCmdIndex == cmdIndex || commands.types[cmdIndex - 1] == MOVE_TO)
 		{
 			wasLastMove = true;
 		}
@@ -746,26 +794,22 @@ namespace SvgRenderer::Flattening {
 			break;
 		case LINE_TO:
 		{
-			glm::vec2 point = cmd.transformedPoints[0];
-			HandleLine(cmd.startIndexSimpleCommands, last, point, wasLastMove);
+			glm::vec2 point = points[0];
+			HandleLine(startIndexSimpleCommands, last, point, wasLastMove);
 			break;
 		}
 		case QUAD_TO:
 		{
-			const glm::vec2& p1 = cmd.transformedPoints[0];
-			const glm::vec2& p2 = cmd.transformedPoints[1];
+			const glm::vec2& p1 = points[0];
+			const glm::vec2& p2 = points[1];
 
 			glm::vec2 lastFlattened = last;
-			uint32_t simpleCmdIndex = cmd.startIndexSimpleCommands;
+			uint32_t simpleCmdIndex = startIndexSimpleCommands;
 
-			const float dt = glm::sqrt((4.0f * tolerance) / glm::length(last - 2.0f * p1 + p2));
-			float t = 0.0f;
-			while (t < 1.0f)
+			for (uint32_t i = 1; i <= range.segmentCount; i++)
 			{
-				t = glm::min(t + dt, 1.0f);
-				const glm::vec2 p01 = glm::lerp(last, p1, t);
-				const glm::vec2 p12 = glm::lerp(p1, p2, t);
-				const glm::vec2 point = glm::lerp(p01, p12, t);
+				const float t = static_cast<float>(i) / static_cast<float>(range.segmentCount);
+				const glm::vec2 point = EvaluateQuad(last, p1, p2, t);
 
 				simpleCmdIndex += HandleLine(simpleCmdIndex, lastFlattened, point, wasLastMove);
 				lastFlattened = point;
@@ -776,27 +820,17 @@ namespace SvgRenderer::Flattening {
 		}
 		case CUBIC_TO:
 		{
-			const glm::vec2& p1 = cmd.transformedPoints[0];
-			const glm::vec2& p2 = cmd.transformedPoints[1];
-			const glm::vec2& p3 = cmd.transformedPoints[2];
+			const glm::vec2& p1 = points[0];
+			const glm::vec2& p2 = points[1];
+			const glm::vec2& p3 = points[2];
 
 			glm::vec2 lastFlattened = last;
-			uint32_t simpleCmdIndex = cmd.startIndexSimpleCommands;
+			uint32_t simpleCmdIndex = startIndexSimpleCommands;
 
-			const glm::vec2 a = -1.0f * last + 3.0f * p1 - 3.0f * p2 + p3;
-			const glm::vec2 b = 3.0f * (last - 2.0f * p1 + p2);
-			const float conc = glm::max(glm::length(b), glm::length(a + b));
-			const float dt = glm::sqrt((glm::sqrt(8.0f) * tolerance) / conc);
-			float t = 0.0f;
-			while (t < 1.0f)
+			for (uint32_t i = 1; i <= range.segmentCount; i++)
 			{
-				t = glm::min(t + dt, 1.0f);
-				const glm::vec2 p01 = glm::lerp(last, p1, t);
-				const glm::vec2 p12 = glm::lerp(p1, p2, t);
-				const glm::vec2 p23 = glm::lerp(p2, p3, t);
-				const glm::vec2 p012 = glm::lerp(p01, p12, t);
-				const glm::vec2 p123 = glm::lerp(p12, p23, t);
-				const glm::vec2 point = glm::lerp(p012, p123, t);
+				const float t = static_cast<float>(i) / static_cast<float>(range.segmentCount);
+				const glm::vec2 point = EvaluateCubic(last, p1, p2, p3, t);
 
 				simpleCmdIndex += HandleLine(simpleCmdIndex, lastFlattened, point, wasLastMove);
 				lastFlattened = point;
@@ -9,7 +9,6 @@
 namespace SvgRenderer {
 
 	struct PathCmd;
-	struct PathRenderCmd;
 	struct SimpleCommand;
 
 }
@@ -18,10 +17,12 @@ namespace SvgRenderer::Flattening {
 
 	glm::vec2 ProjectPointOntoScreenBoundary(glm::vec2 point);
 
-	void Flatten(uint32_t cmdIndex, const glm::vec2& last, float tolerance);
-	uint32_t CalculateNumberOfSimpleCommands(uint32_t cmdIndex, glm::vec2 last, float tolerance);
+	// Writes the simple commands of the command into its range, flattening the curves into the segment count of the range
+	void Flatten(uint32_t cmdIndex, const glm::vec2& last);
+	// Returns the number of simple commands of the command, segmentCount gets the number of lines it is flattened into
+	uint32_t CalculateNumberOfSimpleCommands(uint32_t cmdIndex, glm::vec2 last, float tolerance, uint32_t& segmentCount);
 
-	BoundingBox FlattenIntoArray(const PathRenderCmd& cmd, glm::vec2 last, float tolerance);
+	BoundingBox FlattenIntoArray(uint32_t cmdIndex, glm::vec2 last, float tolerance);
 
 	bool IsPointInsideViewSpace(const glm::vec2& v);
 	bool IsLineInsideViewSpace(glm::vec2 p0, glm::vec2 p1);
@@ -0,0 +1,68 @@
+#include "GPUProfiler.h"
+
+#include <glad/glad.h>
+
+namespace SvgRenderer {
+
+	void GPUProfiler::Init()
+	{
+		for (Frame& frame : m_Frames)
+		{
+			glGenQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+		}
+	}
+
+	void GPUProfiler::Shutdown()
+	{
+		for (Frame& frame : m_Frames)
+		{
+			glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+		}
+	}
+
+	void GPUProfiler::BeginFrame()
+	{
+		Frame& frame = m_Frames[m_FrameIndex];
+		if (frame.pending)
+		{
+			ReadFrame(frame);
+		}
+
+		frame.stageCount = 0;
+		frame.pending = false;
+		glQueryCounter(frame.queries[0], GL_TIMESTAMP);
+	}
+
+	void GPUProfiler::EndStage(const char* name)
+	{
+		Frame& frame = m_Frames[m_FrameIndex];
+		SR_ASSERT(frame.stageCount < MAX_STAGES, "Too many GPU stages");
+
+		frame.names[frame.stageCount] = name;
+		glQueryCounter(frame.queries[++frame.stageCount], GL_TIMESTAMP);
+	}
+
+	void GPUProfiler::EndFrame()
+	{
+		m_Frames[m_FrameIndex].pending = true;
+		m_FrameIndex = (m_FrameIndex + 1) % FRAMES_IN_FLIGHT;
+	}
+
+	void GPUProfiler::ReadFrame(Frame& frame)
+	{
+		// Blocks only if the GPU is more than FRAMES_IN_FLIGHT frames behind
+		std::array<uint64_t, MAX_STAGES + 1> timestamps;
+		for (uint32_t i = 0; i <= frame.stageCount; i++)
+		{
+			glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+		}
+
+		for (uint32_t i = 0; i < frame.stageCount; i++)
+		{
+			SR_TRACE("GPU {0}: {1} ms", frame.names[i], (timestamps[i + 1] - timestamps[i]) / 1'000'000.0f);
+		}
+
+		SR_TRACE("GPU total: {0} ms", (timestamps[frame.stageCount] - timestamps[0]) / 1'000'000.0f);
+	}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace SvgRenderer {
+
+	// Per-stage GPU timings from timestamp queries. Queries of a frame are read back only when
+	// its slot in the ring is reused, FRAMES_IN_FLIGHT frames later, so reading them does not stall
+	class GPUProfiler
+	{
+	public:
+		static constexpr uint32_t FRAMES_IN_FLIGHT = 4;
+		static constexpr uint32_t MAX_STAGES = 32;
+	public:
+		void Init();
+		void Shutdown();
+
+		// Logs the timings of the frame that used this slot before, and records the start of the frame
+		void BeginFrame();
+		// Records the end of the stage, the stage started where the previous one ended
+		void EndStage(const char* name);
+		void EndFrame();
+	private:
+		struct Frame
+		{
+			std::array<uint32_t, MAX_STAGES + 1> queries{};
+			std::array<const char*, MAX_STAGES> names{};
+			uint32_t stageCount = 0;
+			bool pending = false;
+		};
+
+		void ReadFrame(Frame& frame);
+	private:
+		std::array<Frame, FRAMES_IN_FLIGHT> m_Frames;
+		uint32_t m_FrameIndex = 0;
+	};
+
+}
@@ -0,0 +1,181 @@
+#include "Image.h"
+
+#include <fstream>
+
+namespace SvgRenderer {
+
+	static uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+	{
+		static const std::array<uint32_t, 256> table = []()
+		{
+			std::array<uint32_t, 256> table;
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t c = i;
+				for (uint32_t k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+
+				table[i] = c;
+			}
+
+			return table;
+		}();
+
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++)
+		{
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+
+		return ~crc;
+	}
+
+	static void PushBigEndian(std::vector<uint8_t>& buffer, uint32_t value)
+	{
+		buffer.push_back(static_cast<uint8_t>(value >> 24));
+		buffer.push_back(static_cast<uint8_t>(value >> 16));
+		buffer.push_back(static_cast<uint8_t>(value >> 8));
+		buffer.push_back(static_cast<uint8_t>(value));
+	}
+
+	static void WritePngChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+	{
+		std::vector<uint8_t> chunk;
+		chunk.reserve(data.size() + 12);
+		PushBigEndian(chunk, static_cast<uint32_t>(data.size()));
+		chunk.insert(chunk.end(), type, type + 4);
+		chunk.insert(chunk.end(), data.begin(), data.end());
+		// CRC covers the chunk type and data, but not the length
+		PushBigEndian(chunk, Crc32(chunk.data() + 4, chunk.size() - 4));
+		file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+	}
+
+	Image::Image(uint32_t width, uint32_t height)
+	{
+		Resize(width, height);
+	}
+
+	void Image::Resize(uint32_t width, uint32_t height)
+	{
+		m_Width = width;
+		m_Height = height;
+		m_Pixels.resize(static_cast<size_t>(width) * height * 4);
+	}
+
+	void Image::Clear(const std::array<uint8_t, 4>& color)
+	{
+		for (size_t i = 0; i < m_Pixels.size(); i += 4)
+		{
+			m_Pixels[i + 0] = color[0];
+			m_Pixels[i + 1] = color[1];
+			m_Pixels[i + 2] = color[2];
+			m_Pixels[i + 3] = color[3];
+		}
+	}
+
+	bool Image::Save(const std::filesystem::path& filepath) const
+	{
+		if (filepath.extension() == ".png")
+		{
+			return SavePNG(filepath);
+		}
+
+		return SavePPM(filepath);
+	}
+
+	bool Image::SavePPM(const std::filesystem::path& filepath) const
+	{
+		std::ofstream file(filepath, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+
+		file << "P6\n" << m_Width << ' ' << m_Height << "\n255\n";
+
+		// PPM has no alpha channel
+		std::vector<uint8_t> row(m_Width * 3);
+		for (uint32_t y = 0; y < m_Height; y++)
+		{
+			const uint8_t* src = GetRow(y);
+			for (uint32_t x = 0; x < m_Width; x++)
+			{
+				row[x * 3 + 0] = src[x * 4 + 0];
+				row[x * 3 + 1] = src[x * 4 + 1];
+				row[x * 3 + 2] = src[x * 4 + 2];
+			}
+
+			file.write(reinterpret_cast<const char*>(row.data()), row.size());
+		}
+
+		return file.good();
+	}
+
+	bool Image::SavePNG(const std::filesystem::path& filepath) const
+	{
+		std::ofstream file(filepath, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+
+		static constexpr uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+		std::vector<uint8_t> header;
+		PushBigEndian(header, m_Width);
+		PushBigEndian(header, m_Height);
+		header.push_back(8); // Bit depth
+		header.push_back(6); // Color type RGBA
+		header.push_back(0); // Compression
+		header.push_back(0); // Filter
+		header.push_back(0); // Interlace
+		WritePngChunk(file, "IHDR", header);
+
+		// Scanlines are prefixed by filter type 0 (none)
+		const size_t rowSize = static_cast<size_t>(m_Width) * 4 + 1;
+		std::vector<uint8_t> raw(rowSize * m_Height);
+		for (uint32_t y = 0; y < m_Height; y++)
+		{
+			raw[y * rowSize] = 0;
+			std::copy(GetRow(y), GetRow(y) + m_Width * 4, raw.begin() + y * rowSize + 1);
+		}
+
+		// Zlib stream made of stored (uncompressed) deflate blocks, so we do not need zlib
+		static constexpr size_t MAX_BLOCK_SIZE = 65535;
+		std::vector<uint8_t> data;
+		data.reserve(raw.size() + (raw.size() / MAX_BLOCK_SIZE + 1) * 5 + 6);
+		data.push_back(0x78);
+		data.push_back(0x01);
+
+		size_t offset = 0;
+		do
+		{
+			const size_t blockSize = std::min(raw.size() - offset, MAX_BLOCK_SIZE);
+			const bool isFinal = offset + blockSize == raw.size();
+			data.push_back(isFinal ? 1 : 0);
+			data.push_back(static_cast<uint8_t>(blockSize));
+			data.push_back(static_cast<uint8_t>(blockSize >> 8));
+			data.push_back(static_cast<uint8_t>(~blockSize));
+			data.push_back(static_cast<uint8_t>(~blockSize >> 8));
+			data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+			offset += blockSize;
+		} while (offset < raw.size());
+
+		uint32_t a = 1, b = 0;
+		for (uint8_t value : raw)
+		{
+			a = (a + value) % 65521;
+			b = (b + a) % 65521;
+		}
+
+		PushBigEndian(data, (b << 16) | a);
+		WritePngChunk(file, "IDAT", data);
+		WritePngChunk(file, "IEND", {});
+
+		return file.good();
+	}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <vector>
+
+namespace SvgRenderer {
+
+	// Tightly packed RGBA8 image in host memory, row 0 is the top of the image
+	class Image
+	{
+	public:
+		Image() = default;
+		Image(uint32_t width, uint32_t height);
+
+		void Resize(uint32_t width, uint32_t height);
+		void Clear(const std::array<uint8_t, 4>& color);
+
+		// Writes the image as PPM or PNG, chosen by the extension of the filepath
+		bool Save(const std::filesystem::path& filepath) const;
+
+		uint8_t* GetRow(uint32_t y) { return m_Pixels.data() + static_cast<size_t>(y) * m_Width * 4; }
+		const uint8_t* GetRow(uint32_t y) const { return m_Pixels.data() + static_cast<size_t>(y) * m_Width * 4; }
+
+		uint32_t GetWidth() const { return m_Width; }
+		uint32_t GetHeight() const { return m_Height; }
+		const std::vector<uint8_t>& GetPixels() const { return m_Pixels; }
+	private:
+		bool SavePPM(const std::filesystem::path& filepath) const;
+		bool SavePNG(const std::filesystem::path& filepath) const;
+	private:
+		uint32_t m_Width = 0, m_Height = 0;
+		std::vector<uint8_t> m_Pixels;
+	};
+
+}
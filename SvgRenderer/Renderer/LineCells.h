@@ -0,0 +1,87 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <limits>
+
+namespace SvgRenderer {
+
+	// Walks the pixel cells crossed by the line from last to point in order and calls cell(x, y, area, height) for each of them,
+	// with the part of the line inside the cell as its signed height and the area between it and the right edge of the cell
+	template<typename CellFunc>
+	void ForEachLineCell(const glm::vec2& last, const glm::vec2& point, CellFunc&& cell)
+	{
+		if (point == last)
+		{
+			return;
+		}
+
+		int32_t xDir = point.x > last.x ? 1 : (point.x < last.x ? -1 : 0);
+		int32_t yDir = point.y > last.y ? 1 : (point.y < last.y ? -1 : 0);
+		float dtdx = 1.0f / (point.x - last.x);
+		float dtdy = 1.0f / (point.y - last.y);
+		int32_t x = glm::floor(last.x); // Convert to int
+		int32_t y = glm::floor(last.y);  // Convert to int
+		float rowt0 = 0.0f;
+		float colt0 = 0.0f;
+
+		float rowt1;
+		if (last.y == point.y)
+		{
+			rowt1 = std::numeric_limits<float>::max();
+		}
+		else
+		{
+			float nextY = point.y > last.y ? y + 1 : y;
+			rowt1 = glm::min((dtdy * (nextY - last.y)), 1.0f);
+		}
+
+		float colt1;
+		if (last.x == point.x)
+		{
+			colt1 = std::numeric_limits<float>::max();
+		}
+		else
+		{
+			float nextX = point.x > last.x ? x + 1 : x;
+			colt1 = glm::min((dtdx * (nextX - last.x)), 1.0f);
+		}
+
+		float xStep = glm::abs(dtdx);
+		float yStep = glm::abs(dtdy);
+
+		while (true)
+		{
+			float t0 = glm::max(rowt0, colt0);
+			float t1 = glm::min(rowt1, colt1);
+			glm::vec2 p0 = (1.0f - t0) * last + t0 * point;
+			glm::vec2 p1 = (1.0f - t1) * last + t1 * point;
+			float height = p1.y - p0.y;
+			float right = x + 1;
+			float area = 0.5f * height * ((right - p0.x) + (right - p1.x));
+
+			cell(x, y, area, height);
+
+			// Advance to the next scanline
+			if (rowt1 < colt1)
+			{
+				rowt0 = rowt1;
+				rowt1 = glm::min((rowt1 + yStep), 1.0f);
+				y += yDir;
+			}
+			else
+			{
+				colt0 = colt1;
+				colt1 = glm::min((colt1 + xStep), 1.0f);
+				x += xDir;
+			}
+
+			// Break the loop if we are on the end
+			if (rowt0 == 1.0f || colt0 == 1.0f)
+			{
+				break;
+			}
+		}
+	}
+
+}
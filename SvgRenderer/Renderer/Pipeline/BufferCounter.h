@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace SvgRenderer {
+
+	// Tracks how many elements of a scene buffer are used, and decides when the buffer has to grow.
+	// Buffers never shrink, so after a few frames the capacity settles and is reused every frame
+	struct BufferCounter
+	{
+		uint32_t used = 0; // Used in the last frame
+		uint32_t peak = 0; // Peak over all the frames
+		uint32_t capacity = 0;
+
+		// Records the usage of this frame, returns true if the buffer has to be reallocated,
+		// in that case the capacity is already updated to the new size
+		bool Require(uint32_t count)
+		{
+			used = count;
+			peak = std::max(peak, count);
+			if (count <= capacity)
+			{
+				return false;
+			}
+
+			capacity = std::max(count, capacity + capacity / 2);
+			return true;
+		}
+
+		// Records the usage of a buffer of fixed capacity, count is what was requested, so it is past
+		// the capacity when the buffer overflowed. Returns true in that case
+		bool RequireFixed(uint32_t count, uint32_t fixedCapacity)
+		{
+			used = count;
+			peak = std::max(peak, count);
+			capacity = fixedCapacity;
+			return count > capacity;
+		}
+
+		bool HasOverflowed() const { return used > capacity; }
+	};
+
+	struct BufferCounters
+	{
+		BufferCounter simpleCommands;
+		BufferCounter tiles;
+		BufferCounter tileIncrements;
+		BufferCounter quads;
+	};
+
+}
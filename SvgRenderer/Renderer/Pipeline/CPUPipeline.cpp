@@ -3,24 +3,26 @@
 #include "Core/Filesystem.h"
 #include "Core/Timer.h"
 
+#include "Renderer/BinnedRasterizer.h"
 #include "Renderer/Flattening.h"
+#include "Renderer/PointTransform.h"
 #include "Renderer/Rasterizer.h"
 
 #include <glad/glad.h>
 
+#include <numeric>
+
 namespace SvgRenderer {
 
-	static glm::vec2 ApplyTransform(const glm::mat4& transform, const glm::vec2& point)
+	static void TransformPath(const PathRender& path)
 	{
-		return Globals::GlobalTransform * (transform * glm::vec4(point, 1.0f, 1.0f));
-	}
+		// Points of the path are contiguous, so the whole path is a single batch with one combined transform
+		CommandsContainer& commands = Globals::AllPaths.commands;
+		const uint32_t firstPoint = commands.pointsOffsets[path.startCmdIndex];
+		const uint32_t lastPoint = commands.pointsOffsets[path.endCmdIndex + 1];
 
-	static void TransformCurve(PathRenderCmd& cmd)
-	{
-		uint32_t pathIndex = GET_CMD_PATH_INDEX(cmd.pathIndexCmdType);
-		cmd.transformedPoints[0] = ApplyTransform(Globals::AllPaths.paths[pathIndex].transform, cmd.points[0]);
-		cmd.transformedPoints[1] = ApplyTransform(Globals::AllPaths.paths[pathIndex].transform, cmd.points[1]);
-		cmd.transformedPoints[2] = ApplyTransform(Globals::AllPaths.paths[pathIndex].transform, cmd.points[2]);
+		const AffineTransform transform = AffineTransform::FromMat4(Globals::GlobalTransform * path.transform);
+		TransformPoints(transform, &commands.points[firstPoint], &commands.transformedPoints[firstPoint], lastPoint - firstPoint);
 	}
 
 	static glm::vec2 GetPreviousPoint(const PathRender& path, uint32_t index)
@@ -30,18 +32,8 @@ namespace SvgRenderer {
 			return glm::vec2(0, 0);
 		}
 
-		PathRenderCmd& prevCmd = Globals::AllPaths.commands[index - 1];
-		uint32_t pathType = GET_CMD_TYPE(prevCmd.pathIndexCmdType);
-		switch (pathType)
-		{
-		case MOVE_TO:
-		case LINE_TO:
-			return prevCmd.transformedPoints[0];
-		case QUAD_TO:
-			return prevCmd.transformedPoints[1];
-		case CUBIC_TO:
-			return prevCmd.transformedPoints[2];
-		}
+		// Last point of the previous command
+		return Globals::AllPaths.commands.transformedPoints[Globals::AllPaths.commands.pointsOffsets[index] - 1];
 	}
 
 	static glm::vec2 GetPreviousFlattenedPoint(uint32_t pathIndex, uint32_t cmdIndex)
@@ -52,18 +44,18 @@ namespace SvgRenderer {
 			return glm::vec2(0, 0);
 		}
 
-		const PathRenderCmd& cmd = Globals::AllPaths.commands[cmdIndex - 1];
-		if (cmd.startIndexSimpleCommands != cmd.endIndexSimpleCommands)
+		const CommandsContainer& commands = Globals::AllPaths.commands;
+		const SimpleCommandsRange& range = commands.simpleCommandRanges[cmdIndex - 1];
+		if (range.start != range.end)
 		{
-			return Globals::AllPaths.simpleCommands[cmd.endIndexSimpleCommands - 1].point;
+			return Globals::AllPaths.simpleCommands[range.end - 1].point;
 		}
 
-		uint32_t pathType = GET_CMD_TYPE(cmd.pathIndexCmdType);
-		switch (pathType)
+		switch (commands.types[cmdIndex - 1])
 		{
 		case MOVE_TO:
 		{
-			return cmd.transformedPoints[0];
+			return commands.GetTransformedPoints(cmdIndex - 1)[0];
 		}
 		}
 
@@ -71,15 +63,27 @@ namespace SvgRenderer {
 		return glm::vec2(0, 0);
 	}
 
-	// This remains fixed for the whole run of the program, may change in the future
-	// For now, it is designed to store all the data from paris.svg,
-	// but I am sure there is a way to resize this according to the size
-	// we need for the SVG
-	static constexpr uint32_t SIMPLE_COMMANDS_COUNT = 2'000'000;
-	static constexpr uint32_t TILES_COUNT = 1'000'000;
-	static constexpr uint32_t QUADS_COUNT = 250'000;
-	static constexpr uint32_t VERTICES_COUNT = QUADS_COUNT * 4;
-	static constexpr uint32_t INDICES_COUNT = QUADS_COUNT * 6;
+	// Calls func(p0, p1) for every flattened line of the path
+	template <class Fn>
+	static void ForEachLine(uint32_t pathIndex, Fn func)
+	{
+		const PathRender& path = Globals::AllPaths.paths[pathIndex];
+		for (uint32_t cmdIndex = path.startCmdIndex; cmdIndex <= path.endCmdIndex; cmdIndex++)
+		{
+			const SimpleCommandsRange& range = Globals::AllPaths.commands.simpleCommandRanges[cmdIndex];
+			glm::vec2 last = GetPreviousFlattenedPoint(pathIndex, cmdIndex);
+			for (uint32_t i = range.start; i < range.end; i++)
+			{
+				const SimpleCommand& simpleCmd = Globals::AllPaths.simpleCommands[i];
+				if (simpleCmd.type == LINE_TO)
+				{
+					func(last, simpleCmd.point);
+				}
+
+				last = simpleCmd.point;
+			}
+		}
+	}
 
 	void CPUPipeline::Init()
 	{
@@ -89,40 +93,34 @@ namespace SvgRenderer {
 		}
 		else
 		{
-			SR_INFO("Running in CPU parallel mode\n");
+			SR_INFO("Running in CPU {0} mode\n", m_CpuMode == CPUMode::Binned ? "binned" : "parallel");
 		}
 
-		Globals::AllPaths.simpleCommands.resize(SIMPLE_COMMANDS_COUNT);
-		Globals::Tiles.tiles.resize(TILES_COUNT);
-		m_TileBuilder.vertices.resize(VERTICES_COUNT);
-		m_TileBuilder.indices.reserve(INDICES_COUNT);
-		m_TileBuilder.atlas.resize(ATLAS_SIZE * ATLAS_SIZE, 0);
+		// Simple commands, tiles and quads are sized every frame by the counts computed in the pipeline,
+		// the binned mode composites straight into the image and needs no atlas
+		if (m_CpuMode != CPUMode::Binned)
+		{
+			m_TileBuilder.atlas.resize(ATLAS_SIZE * ATLAS_SIZE, 0);
+			m_TileBuilder.atlas[0] = 255;
+		}
 
-		// 4 vertices, 6 indices for 1 quad
-		uint32_t vertexIndex = 0;
-		for (size_t i = 0; i < INDICES_COUNT; i += 6)
+		if (IsHeadless())
 		{
-			m_TileBuilder.indices.push_back(vertexIndex + 0);
-			m_TileBuilder.indices.push_back(vertexIndex + 1);
-			m_TileBuilder.indices.push_back(vertexIndex + 2);
-			m_TileBuilder.indices.push_back(vertexIndex + 0);
-			m_TileBuilder.indices.push_back(vertexIndex + 2);
-			m_TileBuilder.indices.push_back(vertexIndex + 3);
-			vertexIndex += 4;
+			SR_INFO("Running headless, output: {0}\n", m_OutputFilepath.string());
+			return;
 		}
 
 		glCreateTextures(GL_TEXTURE_2D, 1, &m_AlphaTexture);
 		glTextureParameteri(m_AlphaTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTextureParameteri(m_AlphaTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTextureStorage2D(m_AlphaTexture, 1, GL_R32F, ATLAS_SIZE, ATLAS_SIZE);
+		glTextureStorage2D(m_AlphaTexture, 1, GL_R8, ATLAS_SIZE, ATLAS_SIZE);
+		glTextureSubImage2D(m_AlphaTexture, 0, 0, 0, ATLAS_SIZE, 1, GL_RED, GL_UNSIGNED_BYTE, m_TileBuilder.atlas.data());
 
 		m_FinalShader = Shader::Create(Filesystem::AssetsPath() / "shaders" / "Main.vert", Filesystem::AssetsPath() / "shaders" / "Main.frag");
 
 		glCreateBuffers(1, &m_Vbo);
 		glCreateBuffers(1, &m_Ibo);
 
-		glNamedBufferData(m_Ibo, m_TileBuilder.indices.size() * sizeof(uint32_t), m_TileBuilder.indices.data(), GL_STATIC_DRAW);
-
 		glCreateVertexArrays(1, &m_Vao);
 		glVertexArrayVertexBuffer(m_Vao, 0, m_Vbo, 0, sizeof(Vertex));
 		glVertexArrayElementBuffer(m_Vao, m_Ibo);
@@ -142,10 +140,22 @@ namespace SvgRenderer {
 
 	void CPUPipeline::Shutdown()
 	{
+		if (IsHeadless())
+		{
+			return;
+		}
+
+		for (void* fence : m_UploadFences)
+		{
+			glDeleteSync(static_cast<GLsync>(fence));
+		}
+
 		glDeleteBuffers(1, &m_Vbo);
 		glDeleteBuffers(1, &m_Ibo);
 		glDeleteVertexArrays(1, &m_Vao);
 		glDeleteTextures(1, &m_AlphaTexture);
+		glDeleteFramebuffers(1, &m_ImageFramebuffer);
+		glDeleteTextures(1, &m_ImageTexture);
 	}
 
 	void CPUPipeline::Render()
@@ -154,36 +164,20 @@ namespace SvgRenderer {
 
 		// 0.step: Reset all the data
 		{
-			std::vector<uint32_t> tileIndices, atlasIndices, pathIndices;
-			tileIndices.resize(TILES_COUNT);
-			atlasIndices.resize(ATLAS_SIZE * ATLAS_SIZE - 1);
-			pathIndices.resize(Globals::AllPaths.paths.size());
-
-			std::iota(tileIndices.begin(), tileIndices.end(), 0);
-			std::iota(atlasIndices.begin(), atlasIndices.end(), 1);
-			std::iota(pathIndices.begin(), pathIndices.end(), 0);
-
 			Timer timerReset;
 
-			ForEach(tileIndices.begin(), tileIndices.end(), [](uint32_t tileIndex)
-			{
-				Globals::Tiles.tiles[tileIndex].hasIncrements = false;
-				Globals::Tiles.tiles[tileIndex].nextTileIndex = std::numeric_limits<uint32_t>::max();
-				Globals::Tiles.tiles[tileIndex].winding = 0;
-				for (uint32_t i = 0; i < TILE_SIZE * TILE_SIZE; i++)
-				{
-					Globals::Tiles.tiles[tileIndex].increments[i].area = 0;
-					Globals::Tiles.tiles[tileIndex].increments[i].height = 0;
-				}
-			});
+			// Tile headers are reset when they are assigned to a path, increments on their first touch
+			Globals::Tiles.increments.Reset();
 
-			ForEach(atlasIndices.begin(), atlasIndices.end(), [this](uint32_t pixelIndex)
-			{
-				m_TileBuilder.atlas[pixelIndex] = 0.0f;
-			});
-			m_TileBuilder.atlas[0] = 1.0f;
+			// The atlas is not cleared, every fine tile overwrites its whole slot and only the slots
+			// written in this frame are referenced by the quads, the full coverage texel is set in Init()
 
-			ForEach(pathIndices.begin(), pathIndices.end(), [this](uint32_t pathIndex)
+			OcclusionContainer& occlusion = Globals::Occlusion;
+			occlusion.tileCountX = (Globals::WindowWidth + TILE_SIZE - 1) / TILE_SIZE;
+			occlusion.tileCountY = (Globals::WindowHeight + TILE_SIZE - 1) / TILE_SIZE;
+			occlusion.occluders.assign(occlusion.tileCountX * occlusion.tileCountY, 0);
+
+			ForEach(0, static_cast<uint32_t>(Globals::AllPaths.paths.size()), [this](uint32_t pathIndex)
 			{
 				Globals::AllPaths.paths[pathIndex].bbox.min = glm::vec2(std::numeric_limits<float>::max());
 				Globals::AllPaths.paths[pathIndex].bbox.max = glm::vec2(-std::numeric_limits<float>::max());
@@ -194,50 +188,28 @@ namespace SvgRenderer {
 
 		// 1.step: Transform the paths
 		{
-			std::vector<uint32_t> indices;
-			indices.resize(Globals::AllPaths.commands.size());
-			std::iota(indices.begin(), indices.end(), 0);
-
 			Timer timerTransform;
-			ForEach(indices.begin(), indices.end(), [](uint32_t cmdIndex)
+			ForEach(0, static_cast<uint32_t>(Globals::AllPaths.paths.size()), [](uint32_t pathIndex)
 			{
-				TransformCurve(Globals::AllPaths.commands[cmdIndex]);
+				TransformPath(Globals::AllPaths.paths[pathIndex]);
 			});
 			SR_TRACE("Transforming paths: {0} ms", timerTransform.ElapsedMillis());
 		}
 
 		// 1.5. step: Calculate coarse bounding box
 		{
-			std::vector<uint32_t> indices;
-			indices.resize(Globals::AllPaths.paths.size());
-			std::iota(indices.begin(), indices.end(), 0);
-
 			Timer timerCalcBbox;
-			ForEach(indices.begin(), indices.end(), [](uint32_t pathIndex)
+			ForEach(0, static_cast<uint32_t>(Globals::AllPaths.paths.size()), [](uint32_t pathIndex)
 			{
 				PathRender& path = Globals::AllPaths.paths[pathIndex];
-				for (uint32_t cmdIndex = path.startCmdIndex; cmdIndex <= path.endCmdIndex; cmdIndex++)
+
+				// Points of the path are contiguous, from the first point of its first command to the last point of its last command
+				const CommandsContainer& commands = Globals::AllPaths.commands;
+				const uint32_t firstPoint = commands.pointsOffsets[path.startCmdIndex];
+				const uint32_t lastPoint = commands.pointsOffsets[path.endCmdIndex + 1];
+				for (uint32_t i = firstPoint; i < lastPoint; i++)
 				{
-					const PathRenderCmd& cmd = Globals::AllPaths.commands[cmdIndex];
-					switch (GET_CMD_TYPE(cmd.pathIndexCmdType))
-					{
-					case MOVE_TO:
-					case LINE_TO:
-						path.bbox.AddPoint(cmd.transformedPoints[0]);
-						break;
-					case QUAD_TO:
-						path.bbox.AddPoint(cmd.transformedPoints[0]);
-						path.bbox.AddPoint(cmd.transformedPoints[1]);
-						break;
-					case CUBIC_TO:
-						path.bbox.AddPoint(cmd.transformedPoints[0]);
-						path.bbox.AddPoint(cmd.transformedPoints[1]);
-						path.bbox.AddPoint(cmd.transformedPoints[2]);
-						break;
-					default:
-						SR_ASSERT(false, "Unknown path type");
-						break;
-					}
+					path.bbox.AddPoint(commands.transformedPoints[i]);
 				}
 
 				path.bbox.AddPadding({ 1.0f, 1.0f });
@@ -249,17 +221,12 @@ namespace SvgRenderer {
 		// 2.step: Flattening
 		// 2.1. Calculate number of simple commands for each path command and their indices
 		{
-			std::vector<uint32_t> indices;
-			indices.resize(Globals::AllPaths.commands.size());
-			std::iota(indices.begin(), indices.end(), 0);
-
 			Timer timerPreFlatten;
 
 			std::atomic_uint32_t simpleCommandsCount = 0;
-			ForEach(indices.begin(), indices.end(), [&simpleCommandsCount](uint32_t cmdIndex)
+			ForEach(0, Globals::AllPaths.commands.Size(), [&simpleCommandsCount](uint32_t cmdIndex)
 			{
-				PathRenderCmd& cmd = Globals::AllPaths.commands[cmdIndex];
-				uint32_t pathIndex = GET_CMD_PATH_INDEX(cmd.pathIndexCmdType);
+				uint32_t pathIndex = Globals::AllPaths.commands.pathIndices[cmdIndex];
 				const PathRender& path = Globals::AllPaths.paths[pathIndex];
 				if (!path.isBboxVisible)
 				{
@@ -267,25 +234,26 @@ namespace SvgRenderer {
 				}
 
 				glm::vec2 last = GetPreviousPoint(Globals::AllPaths.paths[pathIndex], cmdIndex);
-				uint32_t count = Flattening::CalculateNumberOfSimpleCommands(cmdIndex, last, TOLERANCE);
+				uint32_t segmentCount;
+				uint32_t count = Flattening::CalculateNumberOfSimpleCommands(cmdIndex, last, TOLERANCE, segmentCount);
 				uint32_t oldCount = simpleCommandsCount.fetch_add(count);
-				cmd.startIndexSimpleCommands = oldCount;
-				cmd.endIndexSimpleCommands = oldCount + count;
+				Globals::AllPaths.commands.simpleCommandRanges[cmdIndex] = SimpleCommandsRange{ oldCount, oldCount + count, segmentCount };
 			});
+
+			if (m_BufferCounters.simpleCommands.Require(simpleCommandsCount))
+			{
+				Globals::AllPaths.simpleCommands.resize(m_BufferCounters.simpleCommands.capacity);
+			}
+
 			SR_TRACE("Pre-flatten: {0} ms", timerPreFlatten.ElapsedMillis());
 		}
 
 		// 2.2. Actually flatten all the commands
 		{
-			std::vector<uint32_t> indices;
-			indices.resize(Globals::AllPaths.commands.size());
-			std::iota(indices.begin(), indices.end(), 0);
-
 			Timer timerFlatten;
-			ForEach(indices.begin(), indices.end(), [](uint32_t cmdIndex)
+			ForEach(0, Globals::AllPaths.commands.Size(), [](uint32_t cmdIndex)
 			{
-				PathRenderCmd& cmd = Globals::AllPaths.commands[cmdIndex];
-				uint32_t pathIndex = GET_CMD_PATH_INDEX(cmd.pathIndexCmdType);
+				uint32_t pathIndex = Globals::AllPaths.commands.pathIndices[cmdIndex];
 				const PathRender& path = Globals::AllPaths.paths[pathIndex];
 				if (!path.isBboxVisible)
 				{
@@ -293,19 +261,15 @@ namespace SvgRenderer {
 				}
 
 				glm::vec2 last = GetPreviousPoint(path, cmdIndex);
-				Flattening::Flatten(cmdIndex, last, TOLERANCE);
+				Flattening::Flatten(cmdIndex, last);
 			});
 			SR_TRACE("Flattening: {0} ms", timerFlatten.ElapsedMillis());
 		}
 
 		// 3.step: Calculating BBOX
 		{
-			std::vector<uint32_t> indices;
-			indices.resize(Globals::AllPaths.paths.size());
-			std::iota(indices.begin(), indices.end(), 0);
-
 			Timer timerBbox;
-			ForEach(indices.cbegin(), indices.cend(), [](uint32_t pathIndex)
+			ForEach(0, static_cast<uint32_t>(Globals::AllPaths.paths.size()), [](uint32_t pathIndex)
 			{
 				PathRender& path = Globals::AllPaths.paths[pathIndex];
 				if (!path.isBboxVisible)
@@ -317,8 +281,8 @@ namespace SvgRenderer {
 				Globals::AllPaths.paths[pathIndex].bbox.max = glm::vec2(-std::numeric_limits<float>::max());
 				for (uint32_t cmdIndex = path.startCmdIndex; cmdIndex <= path.endCmdIndex; cmdIndex++)
 				{
-					PathRenderCmd& rndCmd = Globals::AllPaths.commands[cmdIndex];
-					for (uint32_t i = rndCmd.startIndexSimpleCommands; i < rndCmd.endIndexSimpleCommands; i++)
+					const SimpleCommandsRange& range = Globals::AllPaths.commands.simpleCommandRanges[cmdIndex];
+					for (uint32_t i = range.start; i < range.end; i++)
 					{
 						path.bbox.AddPoint(Globals::AllPaths.simpleCommands[i].point);
 					}
@@ -330,17 +294,33 @@ namespace SvgRenderer {
 			SR_TRACE("Calculating BBOX: {0} ms", timerBbox.ElapsedMillis());
 		}
 
-		// 4.step: The rest
+		// 4.step: Rasterize either the tiles of every path, or the bands of the screen
+		if (m_CpuMode == CPUMode::Binned)
+		{
+			RenderBins();
+		}
+		else
+		{
+			RenderTiles();
+		}
+
+		LogBufferCounters();
+		SR_INFO("Total execution time: {0} ms", globalTimer.ElapsedMillis());
 
+		static uint32_t totalTime = 0;
+		static uint32_t iters = 0;
+		totalTime += globalTimer.ElapsedMillis();
+		iters++;
+		SR_INFO("Average time: {0} ms", totalTime / static_cast<float>(iters));
+	}
+
+	void CPUPipeline::RenderTiles()
+	{
 		// 4.1: Calculate correct tile indices for each path according to its bounding box
 		{
-			std::vector<uint32_t> indices;
-			indices.resize(Globals::AllPaths.paths.size());
-			std::iota(indices.begin(), indices.end(), 0);
-
 			Timer timer41;
 			std::atomic_uint32_t tileCount = 0;
-			ForEach(indices.cbegin(), indices.cend(), [&tileCount](uint32_t pathIndex)
+			ForEach(0, static_cast<uint32_t>(Globals::AllPaths.paths.size()), [&tileCount](uint32_t pathIndex)
 			{
 				PathRender& path = Globals::AllPaths.paths[pathIndex];
 				if (!path.isBboxVisible)
@@ -367,17 +347,29 @@ namespace SvgRenderer {
 				path.startTileIndex = oldCount;
 				path.endTileIndex = oldCount + count - 1;
 			});
+
+			if (m_BufferCounters.tiles.Require(tileCount))
+			{
+				Globals::Tiles.tiles.resize(m_BufferCounters.tiles.capacity);
+			}
+
+			ForEach(0, static_cast<uint32_t>(Globals::AllPaths.paths.size()), [](uint32_t pathIndex)
+			{
+				const PathRender& path = Globals::AllPaths.paths[pathIndex];
+				if (!path.isBboxVisible)
+				{
+					return;
+				}
+
+				std::fill(Globals::Tiles.tiles.begin() + path.startTileIndex, Globals::Tiles.tiles.begin() + path.endTileIndex + 1, Tile());
+			});
 			SR_TRACE("Step 4.1: {0} ms", timer41.ElapsedMillis());
 		}
 
 		// 4.2: Filling
 		{
-			std::vector<uint32_t> indices;
-			indices.resize(Globals::AllPaths.paths.size());
-			std::iota(indices.begin(), indices.end(), 0);
-
 			Timer timer43;
-			ForEach(indices.cbegin(), indices.cend(), [this](uint32_t pathIndex)
+			ForEach(0, static_cast<uint32_t>(Globals::AllPaths.paths.size()), [this](uint32_t pathIndex)
 			{
 				const PathRender& path = Globals::AllPaths.paths[pathIndex];
 				if (!path.isBboxVisible)
@@ -385,25 +377,17 @@ namespace SvgRenderer {
 					return;
 				}
 
-				std::vector<uint32_t> indices;
-				indices.resize(path.endCmdIndex - path.startCmdIndex + 1);
-				std::iota(indices.begin(), indices.end(), 0);
-
 				Rasterizer rast(pathIndex);
-				ForEach(indices.cbegin(), indices.cend(), [this, pathIndex, &path, &rast](uint32_t cmdIndex)
+				ForEach(0, path.endCmdIndex - path.startCmdIndex + 1, [this, pathIndex, &path, &rast](uint32_t cmdIndex)
 				{
-					const PathRenderCmd& cmd = Globals::AllPaths.commands[cmdIndex + path.startCmdIndex];
+					const SimpleCommandsRange range = Globals::AllPaths.commands.simpleCommandRanges[cmdIndex + path.startCmdIndex];
 					glm::vec2 last = GetPreviousFlattenedPoint(pathIndex, cmdIndex + path.startCmdIndex);
-					std::vector<uint32_t> indices;
-					indices.resize(cmd.endIndexSimpleCommands - cmd.startIndexSimpleCommands);
-					std::iota(indices.begin(), indices.end(), cmd.startIndexSimpleCommands);
-
-					auto GetSimpleCmdPrevPoint = [last, &cmd](uint32_t simpleCmdIndex) -> glm::vec2
+					auto GetSimpleCmdPrevPoint = [last, range](uint32_t simpleCmdIndex) -> glm::vec2
 					{
-						return simpleCmdIndex == cmd.startIndexSimpleCommands ? last : Globals::AllPaths.simpleCommands[simpleCmdIndex - 1].point;
+						return simpleCmdIndex == range.start ? last : Globals::AllPaths.simpleCommands[simpleCmdIndex - 1].point;
 					};
 
-					ForEach(indices.cbegin(), indices.cend(), [this, GetSimpleCmdPrevPoint, &rast](uint32_t i)
+					ForEach(range.start, range.end, [this, GetSimpleCmdPrevPoint, &rast](uint32_t i)
 					{
 						const SimpleCommand& simpleCmd = Globals::AllPaths.simpleCommands[i];
 						glm::vec2 last = GetSimpleCmdPrevPoint(i);
@@ -417,17 +401,50 @@ namespace SvgRenderer {
 					});
 				});
 			});
+			// The pool cannot grow during the frame, increments it could not allocate were dropped by LineTo(),
+			// the requested count keeps the overflow visible in the counters
+			m_BufferCounters.tileIncrements.RequireFixed(Globals::Tiles.increments.GetRequestedCount(), TileIncrementsPool::CAPACITY);
 			SR_TRACE("Filling: {0}", timer43.ElapsedMillis());
 		}
 
-		// 4.3: Calculate correct count and indices for vertices of each path
+		// 4.2.5: Resolve the winding deltas of the tile rows
+		{
+			Timer timerBackdrops;
+			ForEach(0, static_cast<uint32_t>(Globals::AllPaths.paths.size()), [](uint32_t pathIndex)
+			{
+				const PathRender& path = Globals::AllPaths.paths[pathIndex];
+				if (!path.isBboxVisible)
+				{
+					return;
+				}
+
+				Rasterizer rast(pathIndex);
+				rast.ResolveBackdrops();
+			});
+			SR_TRACE("Resolving backdrops: {0}", timerBackdrops.ElapsedMillis());
+		}
+
+		// 4.2.6: Find the screen tiles hidden under opaque spans, their tiles and spans are not drawn
 		{
-			std::vector<uint32_t> indices;
-			indices.resize(Globals::AllPaths.paths.size());
-			std::iota(indices.begin(), indices.end(), 0);
+			Timer timerOcclusion;
+			ForEach(0, static_cast<uint32_t>(Globals::AllPaths.paths.size()), [](uint32_t pathIndex)
+			{
+				const PathRender& path = Globals::AllPaths.paths[pathIndex];
+				if (!path.isBboxVisible)
+				{
+					return;
+				}
+
+				Rasterizer rast(pathIndex);
+				rast.MarkOccluders();
+			});
+			SR_TRACE("Occlusion: {0}", timerOcclusion.ElapsedMillis());
+		}
 
+		// 4.3: Calculate correct count and indices for vertices of each path
+		{
 			Timer timer43;
-			ForEach(indices.cbegin(), indices.cend(), [this](uint32_t pathIndex)
+			ForEach(0, static_cast<uint32_t>(Globals::AllPaths.paths.size()), [this](uint32_t pathIndex)
 			{
 				PathRender& path = Globals::AllPaths.paths[pathIndex];
 				if (!path.isBboxVisible)
@@ -470,17 +487,24 @@ namespace SvgRenderer {
 			}
 
 			m_RenderIndicesCount = accumCount * 6;
+			m_AtlasTileCount = accumTileCount;
+			if (m_BufferCounters.quads.Require(accumCount))
+			{
+				m_TileBuilder.vertices.resize(static_cast<size_t>(m_BufferCounters.quads.capacity) * 4);
+				if (!IsHeadless())
+				{
+					m_TileBuilder.GenerateIndices(m_BufferCounters.quads.capacity);
+					glNamedBufferData(m_Ibo, m_TileBuilder.indices.size() * sizeof(uint32_t), m_TileBuilder.indices.data(), GL_STATIC_DRAW);
+				}
+			}
+
 			SR_TRACE("Prefix sum: {0}", timerPrefixSum.ElapsedMillis());
 		}
 
 		// 4.5: Coarse
 		{
-			std::vector<uint32_t> indices;
-			indices.resize(Globals::AllPaths.paths.size());
-			std::iota(indices.begin(), indices.end(), 0);
-
 			Timer timerCoarse;
-			ForEach(indices.cbegin(), indices.cend(), [this](uint32_t pathIndex)
+			ForEach(0, static_cast<uint32_t>(Globals::AllPaths.paths.size()), [this](uint32_t pathIndex)
 			{
 				const PathRender& path = Globals::AllPaths.paths[pathIndex];
 				if (!path.isBboxVisible)
@@ -496,12 +520,8 @@ namespace SvgRenderer {
 
 		// 4.6: Fine
 		{
-			std::vector<uint32_t> indices;
-			indices.resize(Globals::AllPaths.paths.size());
-			std::iota(indices.begin(), indices.end(), 0);
-
 			Timer timerFine;
-			ForEach(indices.cbegin(), indices.cend(), [this](uint32_t pathIndex)
+			ForEach(0, static_cast<uint32_t>(Globals::AllPaths.paths.size()), [this](uint32_t pathIndex)
 			{
 				const PathRender& path = Globals::AllPaths.paths[pathIndex];
 				if (!path.isBboxVisible)
@@ -515,22 +535,114 @@ namespace SvgRenderer {
 			SR_TRACE("Fine: {0}", timerFine.ElapsedMillis());
 		}
 
-		glNamedBufferData(m_Vbo, m_TileBuilder.vertices.size() * sizeof(Vertex), m_TileBuilder.vertices.data(), GL_STATIC_DRAW);
+		if (!IsHeadless())
+		{
+			Upload();
+		}
+	}
 
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		glTextureSubImage2D(m_AlphaTexture, 0, 0, 0, ATLAS_SIZE, ATLAS_SIZE, GL_RED, GL_FLOAT, m_TileBuilder.atlas.data());
+	void CPUPipeline::RenderBins()
+	{
+		const uint32_t pathCount = static_cast<uint32_t>(Globals::AllPaths.paths.size());
 
-		SR_INFO("Total execution time: {0} ms", globalTimer.ElapsedMillis());
+		// 4.1: Bands of the screen each path can touch, by its bounding box
+		{
+			Timer timerBands;
+			m_BinnedRasterizer.Begin(Globals::WindowWidth, Globals::WindowHeight, pathCount);
+			ForEach(0, pathCount, [this](uint32_t pathIndex)
+			{
+				const PathRender& path = Globals::AllPaths.paths[pathIndex];
+				m_BinnedRasterizer.SetPathBands(pathIndex, path.bbox, path.isBboxVisible);
+			});
 
-		static uint32_t totalTime = 0;
-		static uint32_t iters = 0;
-		totalTime += globalTimer.ElapsedMillis();
-		iters++;
-		SR_INFO("Average time: {0} ms", totalTime / static_cast<float>(iters));
+			m_BinnedRasterizer.AllocateOffsets();
+			SR_TRACE("Path bands: {0} ms", timerBands.ElapsedMillis());
+		}
+
+		// 4.2: Bin the lines of the paths into the bands, counted first, so every path and band has its own range.
+		// The lines of one path are binned on one thread, so no atomics are needed
+		{
+			Timer timerBinning;
+			ForEach(0, pathCount, [this](uint32_t pathIndex)
+			{
+				if (!Globals::AllPaths.paths[pathIndex].isBboxVisible)
+				{
+					return;
+				}
+
+				ForEachLine(pathIndex, [this, pathIndex](const glm::vec2& p0, const glm::vec2& p1)
+				{
+					m_BinnedRasterizer.CountLine(pathIndex, p0, p1);
+				});
+			});
+
+			m_BinnedRasterizer.AllocateLines();
+
+			ForEach(0, pathCount, [this](uint32_t pathIndex)
+			{
+				if (!Globals::AllPaths.paths[pathIndex].isBboxVisible)
+				{
+					return;
+				}
+
+				ForEachLine(pathIndex, [this, pathIndex](const glm::vec2& p0, const glm::vec2& p1)
+				{
+					m_BinnedRasterizer.BinLine(pathIndex, p0, p1);
+				});
+			});
+			SR_TRACE("Binning: {0} ms, {1} lines", timerBinning.ElapsedMillis(), m_BinnedRasterizer.GetLineCount());
+		}
+
+		// 4.3: Rasterize and composite the bands independently, each one goes over its paths in the draw order
+		{
+			Timer timerBands;
+			m_Image.Resize(Globals::WindowWidth, Globals::WindowHeight);
+			m_Image.Clear({ 255, 255, 255, 255 });
+
+			ForEach(0, m_BinnedRasterizer.GetBandCount(), [this](uint32_t band)
+			{
+				m_BinnedRasterizer.RenderBand(band, m_Image);
+			});
+			SR_TRACE("Rendering bands: {0} ms", timerBands.ElapsedMillis());
+		}
+
+		if (!IsHeadless())
+		{
+			UploadImage();
+		}
 	}
 
 	void CPUPipeline::Final()
 	{
+		if (IsHeadless())
+		{
+			// The bands are composited while rendering
+			if (m_CpuMode != CPUMode::Binned)
+			{
+				Composite();
+			}
+
+			Timer timerSave;
+			if (!m_Image.Save(m_OutputFilepath))
+			{
+				SR_ERROR("Could not write image to {0}", m_OutputFilepath.string());
+				return;
+			}
+
+			m_IsImageSaved = true;
+			SR_TRACE("Saving image: {0} ms", timerSave.ElapsedMillis());
+			return;
+		}
+
+		if (m_CpuMode == CPUMode::Binned)
+		{
+			// Row 0 of the image is the top, so it is blitted upside down
+			const GLint width = static_cast<GLint>(m_Image.GetWidth());
+			const GLint height = static_cast<GLint>(m_Image.GetHeight());
+			glBlitNamedFramebuffer(m_ImageFramebuffer, 0, 0, 0, width, height, 0, height, width, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			return;
+		}
+
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 		glEnable(GL_BLEND);
 
@@ -544,6 +656,144 @@ namespace SvgRenderer {
 		glClearColor(1.0, 1.0, 1.0, 1.0);
 		glClear(GL_COLOR_BUFFER_BIT);
 		glDrawElements(GL_TRIANGLES, m_RenderIndicesCount, GL_UNSIGNED_INT, nullptr);
+
+		// The section can be reused once the GPU is done drawing from it, which can be the same section as the last frame
+		// when nothing was rendered in between
+		void*& fence = m_UploadFences[m_DrawSection];
+		if (fence != nullptr)
+		{
+			glDeleteSync(static_cast<GLsync>(fence));
+		}
+
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	void CPUPipeline::Upload()
+	{
+		Timer timerUpload;
+
+		// Vertices go through a persistently mapped buffer split into sections, one per frame in flight,
+		// so filling the next frame does not have to wait for the GPU to finish drawing the current one
+		if (m_UploadQuadCapacity < m_BufferCounters.quads.capacity)
+		{
+			for (void*& fence : m_UploadFences)
+			{
+				if (fence != nullptr)
+				{
+					glClientWaitSync(static_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, std::numeric_limits<uint64_t>::max());
+					glDeleteSync(static_cast<GLsync>(fence));
+					fence = nullptr;
+				}
+			}
+
+			m_UploadQuadCapacity = m_BufferCounters.quads.capacity;
+			const size_t size = static_cast<size_t>(m_UploadQuadCapacity) * 4 * sizeof(Vertex) * UPLOAD_SECTIONS;
+			constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+			glDeleteBuffers(1, &m_Vbo);
+			glCreateBuffers(1, &m_Vbo);
+			glNamedBufferStorage(m_Vbo, size, nullptr, flags);
+			m_MappedVertices = static_cast<Vertex*>(glMapNamedBufferRange(m_Vbo, 0, size, flags));
+		}
+
+		void*& fence = m_UploadFences[m_UploadSection];
+		if (fence != nullptr)
+		{
+			glClientWaitSync(static_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, std::numeric_limits<uint64_t>::max());
+			glDeleteSync(static_cast<GLsync>(fence));
+			fence = nullptr;
+		}
+
+		const size_t firstVertex = static_cast<size_t>(m_UploadSection) * m_UploadQuadCapacity * 4;
+		const size_t vertexCount = static_cast<size_t>(m_RenderIndicesCount / 6) * 4;
+		std::copy_n(m_TileBuilder.vertices.begin(), vertexCount, m_MappedVertices + firstVertex);
+		glVertexArrayVertexBuffer(m_Vao, 0, m_Vbo, firstVertex * sizeof(Vertex), sizeof(Vertex));
+		m_DrawSection = m_UploadSection;
+		m_UploadSection = (m_UploadSection + 1) % UPLOAD_SECTIONS;
+
+		// Only the atlas rows with the tiles of this frame, the first tile is the full coverage one
+		constexpr uint32_t tilesPerRow = ATLAS_SIZE / TILE_SIZE;
+		const uint32_t rowCount = glm::min((m_AtlasTileCount + 1 + tilesPerRow - 1) / tilesPerRow * TILE_SIZE, ATLAS_SIZE);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTextureSubImage2D(m_AlphaTexture, 0, 0, 0, ATLAS_SIZE, rowCount, GL_RED, GL_UNSIGNED_BYTE, m_TileBuilder.atlas.data());
+
+		SR_TRACE("Uploading: {0} ms, {1} vertices, {2} atlas rows", timerUpload.ElapsedMillis(), vertexCount, rowCount);
+	}
+
+	void CPUPipeline::UploadImage()
+	{
+		Timer timerUpload;
+
+		// The texture follows the size of the window
+		if (m_ImageTextureWidth != m_Image.GetWidth() || m_ImageTextureHeight != m_Image.GetHeight())
+		{
+			glDeleteFramebuffers(1, &m_ImageFramebuffer);
+			glDeleteTextures(1, &m_ImageTexture);
+
+			m_ImageTextureWidth = m_Image.GetWidth();
+			m_ImageTextureHeight = m_Image.GetHeight();
+			glCreateTextures(GL_TEXTURE_2D, 1, &m_ImageTexture);
+			glTextureStorage2D(m_ImageTexture, 1, GL_RGBA8, m_ImageTextureWidth, m_ImageTextureHeight);
+
+			glCreateFramebuffers(1, &m_ImageFramebuffer);
+			glNamedFramebufferTexture(m_ImageFramebuffer, GL_COLOR_ATTACHMENT0, m_ImageTexture, 0);
+		}
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTextureSubImage2D(m_ImageTexture, 0, 0, 0, m_ImageTextureWidth, m_ImageTextureHeight, GL_RGBA, GL_UNSIGNED_BYTE, m_Image.GetPixels().data());
+
+		SR_TRACE("Uploading image: {0} ms", timerUpload.ElapsedMillis());
+	}
+
+	void CPUPipeline::Composite()
+	{
+		Timer timerComposite;
+
+		m_Image.Resize(Globals::WindowWidth, Globals::WindowHeight);
+		m_Image.Clear({ 255, 255, 255, 255 });
+
+		// Every quad is exactly one tile row high, so bucket the quads by tile row,
+		// keeping the draw order, and composite the rows independently
+		const uint32_t quadCount = m_RenderIndicesCount / 6;
+		const uint32_t rowCount = (Globals::WindowHeight + TILE_SIZE - 1) / TILE_SIZE;
+		auto GetQuadRow = [this](uint32_t quadIndex) -> int32_t
+		{
+			return glm::floor(static_cast<float>(m_TileBuilder.vertices[quadIndex * 4].pos.y) / TILE_SIZE);
+		};
+
+		m_RowQuadOffsets.assign(rowCount + 1, 0);
+		for (uint32_t quadIndex = 0; quadIndex < quadCount; quadIndex++)
+		{
+			const int32_t row = GetQuadRow(quadIndex);
+			if (row >= 0 && row < static_cast<int32_t>(rowCount))
+			{
+				m_RowQuadOffsets[row + 1]++;
+			}
+		}
+
+		std::partial_sum(m_RowQuadOffsets.begin(), m_RowQuadOffsets.end(), m_RowQuadOffsets.begin());
+		m_RowQuads.resize(m_RowQuadOffsets.back());
+
+		m_RowQuadCursors.assign(m_RowQuadOffsets.begin(), m_RowQuadOffsets.end() - 1);
+		for (uint32_t quadIndex = 0; quadIndex < quadCount; quadIndex++)
+		{
+			const int32_t row = GetQuadRow(quadIndex);
+			if (row >= 0 && row < static_cast<int32_t>(rowCount))
+			{
+				m_RowQuads[m_RowQuadCursors[row]++] = quadIndex;
+			}
+		}
+
+		ForEach(0, rowCount, [this](uint32_t row)
+		{
+			for (uint32_t i = m_RowQuadOffsets[row]; i < m_RowQuadOffsets[row + 1]; i++)
+			{
+				m_TileBuilder.Composite(m_RowQuads[i], m_Image);
+			}
+		});
+
+		SR_TRACE("Compositing: {0} ms", timerComposite.ElapsedMillis());
 	}
 
-}
\ No newline at end of file
+}
@@ -1,38 +1,66 @@
 #pragma once
 
+#include "Core/TaskScheduler.h"
+
 #include "Renderer/Pipeline/Pipeline.h"
+#include "Renderer/BinnedRasterizer.h"
 #include "Renderer/Shader.h"
 #include "Renderer/TileBuilder.h"
+#include "Renderer/Image.h"
+
+#include <array>
+#include <filesystem>
 
 namespace SvgRenderer {
 
+	// Binned rasterizes the bands of the screen in parallel instead of the paths, see BinnedRasterizer
 	enum class CPUMode
 	{
-		Seq = 0, Par
+		Seq = 0, Par, Binned
 	};
 
 	class CPUPipeline : public Pipeline
 	{
 	public:
-		CPUPipeline(CPUMode cpuMode)
-			: m_CpuMode(cpuMode) {}
+		// If the output filepath is set, the pipeline runs headless: it never touches OpenGL,
+		// and Final() composites into an image in memory and writes it to that file.
+		// The scheduler is shared with the rest of the application and has to outlive the pipeline
+		CPUPipeline(CPUMode cpuMode, TaskScheduler& scheduler, const std::filesystem::path& outputFilepath = {})
+			: m_CpuMode(cpuMode), m_Scheduler(scheduler), m_OutputFilepath(outputFilepath) {}
 
 		virtual void Init() override;
 		virtual void Shutdown() override;
 
 		virtual void Render() override;
 		virtual void Final() override;
+
+		bool IsHeadless() const { return !m_OutputFilepath.empty(); }
+		// Whether the headless Final() wrote the image
+		bool IsImageSaved() const { return m_IsImageSaved; }
+		const Image& GetImage() const { return m_Image; }
+	private:
+		// Step 4 of Render() per path, or per band of the screen in CPUMode::Binned
+		void RenderTiles();
+		void RenderBins();
+
+		void Upload();
+		void UploadImage();
+		void Composite();
 	private:
-		template <class FwdIt, class Fn>
-		void ForEach(FwdIt first, FwdIt last, Fn func) noexcept
+		// Calls func for every index in [first, last), on the task scheduler in the parallel mode, the calls can be nested
+		template <class Fn>
+		void ForEach(uint32_t first, uint32_t last, Fn func) noexcept
 		{
 			if (m_CpuMode == CPUMode::Seq)
 			{
-				std::for_each(std::execution::seq, first, last, func);
+				for (uint32_t i = first; i < last; i++)
+				{
+					func(i);
+				}
 			}
 			else
 			{
-				std::for_each(std::execution::par, first, last, func);
+				m_Scheduler.ParallelFor(first, last, func);
 			}
 		}
 	private:
@@ -40,7 +68,27 @@ namespace SvgRenderer {
 		uint32_t m_Vbo = 0, m_Ibo = 0, m_Vao = 0, m_AlphaTexture = 0;
 		Ref<Shader> m_FinalShader;
 		uint32_t m_RenderIndicesCount = 0;
+		uint32_t m_AtlasTileCount = 0;
 		CPUMode m_CpuMode;
+		TaskScheduler& m_Scheduler;
+
+		static constexpr uint32_t UPLOAD_SECTIONS = 3;
+		uint32_t m_UploadQuadCapacity = 0;
+		uint32_t m_UploadSection = 0; // Section the next frame is uploaded to
+		uint32_t m_DrawSection = 0; // Section of the last upload, the one Final() draws from
+		Vertex* m_MappedVertices = nullptr;
+		std::array<void*, UPLOAD_SECTIONS> m_UploadFences{}; // GLsync of the last frame drawn from each section
+
+		std::filesystem::path m_OutputFilepath;
+		Image m_Image;
+		bool m_IsImageSaved = false;
+		std::vector<uint32_t> m_RowQuadOffsets;
+		std::vector<uint32_t> m_RowQuads;
+		std::vector<uint32_t> m_RowQuadCursors;
+
+		BinnedRasterizer m_BinnedRasterizer;
+		uint32_t m_ImageTexture = 0, m_ImageFramebuffer = 0;
+		uint32_t m_ImageTextureWidth = 0, m_ImageTextureHeight = 0;
 	};
 
 }
\ No newline at end of file
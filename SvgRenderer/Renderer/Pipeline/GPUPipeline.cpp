@@ -8,48 +8,55 @@
 
 #include <glad/glad.h>
 
+#include <limits>
+
 namespace SvgRenderer {
 
-	// This remains fixed for the whole run of the program, may change in the future
-	// For now, it is designed to store all the data from paris.svg,
-	// but I am sure there is a way to resize this according to the size
-	// we need for the SVG
-	static constexpr uint32_t SIMPLE_COMMANDS_COUNT = 2'000'000;
-	static constexpr uint32_t TILES_COUNT = 1'000'000;
-	static constexpr uint32_t QUADS_COUNT = 250'000;
-	static constexpr uint32_t VERTICES_COUNT = QUADS_COUNT * 4;
-	static constexpr uint32_t INDICES_COUNT = QUADS_COUNT * 6;
+	// Offsets of the counters in the helpers buffer, in uints
+	static constexpr uint32_t PRE_FLATTEN_COUNTER = 0;
+	static constexpr uint32_t PRE_FILL_COUNTER = 1;
+	static constexpr uint32_t RENDER_INDICES_COUNT = 2;
+	static constexpr uint32_t INCREMENTS_COUNTER = 3;
+	static constexpr uint32_t COUNTER_COUNT = 4;
+
+	// Offsets of the indirect dispatch arguments in the worklists buffer, in bytes
+	static constexpr size_t PATHS_DISPATCH_OFFSET = 0;
+	static constexpr size_t CMDS_DISPATCH_OFFSET = 4 * sizeof(uint32_t);
+
+	// Paths handled by one workgroup of PrefixSum.comp
+	static constexpr uint32_t SCAN_WG_SIZE = 256;
+
+	static uint32_t GetScanGroupCount()
+	{
+		return glm::max((Globals::PathsCount + SCAN_WG_SIZE - 1) / SCAN_WG_SIZE, 1u);
+	}
+
+	static uint32_t GetScreenTileCount()
+	{
+		return ((Globals::WindowWidth + TILE_SIZE - 1) / TILE_SIZE) * ((Globals::WindowHeight + TILE_SIZE - 1) / TILE_SIZE);
+	}
 
 	void GPUPipeline::Init()
 	{
 		SR_INFO("Running in GPU mode\n");
 
-		Globals::PathsCount = static_cast<uint32_t>(Globals::AllPaths.paths.size());
-		Globals::CommandsCount = static_cast<uint32_t>(Globals::AllPaths.commands.size());
+		// Uploaded straight from the scene cache, if the scene was loaded from it
+		const SceneView& scene = Globals::Scene;
+		Globals::PathsCount = static_cast<uint32_t>(scene.paths.size());
+		Globals::CommandsCount = scene.GetCmdCount();
 
-		Globals::AllPaths.simpleCommands.resize(SIMPLE_COMMANDS_COUNT);
-		Globals::Tiles.tiles.resize(TILES_COUNT);
-		m_TileBuilder.vertices.resize(VERTICES_COUNT);
-		m_TileBuilder.indices.reserve(INDICES_COUNT);
-		m_TileBuilder.atlas.resize(ATLAS_SIZE * ATLAS_SIZE, 0);
-
-		// 4 vertices, 6 indices for 1 quad
-		uint32_t vertexIndex = 0;
-		for (size_t i = 0; i < INDICES_COUNT; i += 6)
-		{
-			m_TileBuilder.indices.push_back(vertexIndex + 0);
-			m_TileBuilder.indices.push_back(vertexIndex + 1);
-			m_TileBuilder.indices.push_back(vertexIndex + 2);
-			m_TileBuilder.indices.push_back(vertexIndex + 0);
-			m_TileBuilder.indices.push_back(vertexIndex + 2);
-			m_TileBuilder.indices.push_back(vertexIndex + 3);
-			vertexIndex += 4;
-		}
+		// Initial guesses from the size of the SVG, the buffers grow to the real counts
+		// computed on the GPU during the first frames and are reused afterwards
+		m_BufferCounters.simpleCommands.Require(glm::max(Globals::CommandsCount * 4, 1u));
+		m_BufferCounters.tiles.Require(glm::max(Globals::PathsCount * 4, 1u));
+		m_BufferCounters.tileIncrements.Require(glm::max(Globals::PathsCount, 1u));
+		m_BufferCounters.quads.Require(glm::max(Globals::PathsCount * 4, 1u));
+		m_TileBuilder.GenerateIndices(m_BufferCounters.quads.capacity);
 
 		glCreateTextures(GL_TEXTURE_2D, 1, &m_AlphaTexture);
 		glTextureParameteri(m_AlphaTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTextureParameteri(m_AlphaTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTextureStorage2D(m_AlphaTexture, 1, GL_R32F, ATLAS_SIZE, ATLAS_SIZE);
+		glTextureStorage2D(m_AlphaTexture, 1, GL_R8, ATLAS_SIZE, ATLAS_SIZE);
 
 		glCreateBuffers(1, &m_VerticesBuf);
 		glCreateBuffers(1, &m_Ibo);
@@ -78,30 +85,83 @@ namespace SvgRenderer {
 
 		glCreateBuffers(1, &m_ParamsBuf);
 		glCreateBuffers(1, &m_PathsBuf);
-		glCreateBuffers(1, &m_CmdsBuf);
+		glCreateBuffers(1, &m_CmdTypesBuf);
+		glCreateBuffers(1, &m_CmdPathIndicesBuf);
+		glCreateBuffers(1, &m_CmdPointsOffsetsBuf);
+		glCreateBuffers(1, &m_CmdSimpleRangesBuf);
+		glCreateBuffers(1, &m_PointsBuf);
+		glCreateBuffers(1, &m_TransformedPointsBuf);
 		glCreateBuffers(1, &m_SimpleCmdsBuf);
 		glCreateBuffers(1, &m_TilesBuf);
-		glCreateBuffers(1, &m_AtlasBuf);
 		glCreateBuffers(1, &m_HelpersBuf);
+		glCreateBuffers(1, &m_TileIncrementsBuf);
+		glCreateBuffers(1, &m_OccludersBuf);
+		glCreateBuffers(1, &m_ScanPartialsBuf);
+		glCreateBuffers(1, &m_WorklistsBuf);
+		glCreateBuffers(1, &m_VisiblePathsBuf);
+		glCreateBuffers(1, &m_VisibleCmdsBuf);
+		glCreateBuffers(1, &m_CountersReadbackBuf);
 
 		constexpr GLenum bufferFlags = 0;
 		glNamedBufferStorage(m_ParamsBuf, sizeof(ParamsBuf), nullptr, GL_DYNAMIC_STORAGE_BIT);
-		glNamedBufferStorage(m_PathsBuf, Globals::AllPaths.paths.size() * sizeof(PathRender), Globals::AllPaths.paths.data(), bufferFlags);
-		glNamedBufferStorage(m_CmdsBuf, Globals::AllPaths.commands.size() * sizeof(PathRenderCmd), Globals::AllPaths.commands.data(), bufferFlags);
-		glNamedBufferStorage(m_SimpleCmdsBuf, Globals::AllPaths.simpleCommands.size() * sizeof(SimpleCommand), Globals::AllPaths.simpleCommands.data(), bufferFlags);
-		glNamedBufferStorage(m_TilesBuf, Globals::Tiles.tiles.size() * sizeof(Tile), Globals::Tiles.tiles.data(), bufferFlags);
-		glNamedBufferStorage(m_VerticesBuf, m_TileBuilder.vertices.size() * sizeof(Vertex), m_TileBuilder.vertices.data(), bufferFlags);
-		glNamedBufferStorage(m_AtlasBuf, m_TileBuilder.atlas.size() * sizeof(float), m_TileBuilder.atlas.data(), bufferFlags);
-		glNamedBufferStorage(m_HelpersBuf, 3 * sizeof(uint32_t), nullptr, bufferFlags);
+		glNamedBufferStorage(m_PathsBuf, scene.paths.size_bytes(), scene.paths.data(), bufferFlags);
+
+		// The shaders read the 8-bit types as uints, so the stream is padded to whole uints, the cache already is
+		std::vector<uint8_t> paddedCmdTypes;
+		std::span<const uint8_t> cmdTypes = scene.cmdTypes;
+		if (cmdTypes.size() % 4 != 0)
+		{
+			paddedCmdTypes.assign(cmdTypes.begin(), cmdTypes.end());
+			paddedCmdTypes.resize((paddedCmdTypes.size() + 3) / 4 * 4);
+			cmdTypes = paddedCmdTypes;
+		}
+
+		glNamedBufferStorage(m_CmdTypesBuf, cmdTypes.size(), cmdTypes.data(), bufferFlags);
+		glNamedBufferStorage(m_CmdPathIndicesBuf, scene.cmdPathIndices.size_bytes(), scene.cmdPathIndices.data(), bufferFlags);
+		glNamedBufferStorage(m_CmdPointsOffsetsBuf, scene.cmdPointsOffsets.size_bytes(), scene.cmdPointsOffsets.data(), bufferFlags);
+		glNamedBufferStorage(m_CmdSimpleRangesBuf, Globals::CommandsCount * sizeof(SimpleCommandsRange), nullptr, bufferFlags);
+		glNamedBufferStorage(m_PointsBuf, scene.points.size_bytes(), scene.points.data(), bufferFlags);
+		glNamedBufferStorage(m_TransformedPointsBuf, scene.points.size_bytes(), nullptr, bufferFlags);
+
+		glNamedBufferStorage(m_SimpleCmdsBuf, m_BufferCounters.simpleCommands.capacity * sizeof(SimpleCommand), nullptr, bufferFlags);
+		glNamedBufferStorage(m_TilesBuf, m_BufferCounters.tiles.capacity * sizeof(Tile), nullptr, bufferFlags);
+		glNamedBufferStorage(m_VerticesBuf, m_BufferCounters.quads.capacity * 4 * sizeof(Vertex), nullptr, bufferFlags);
+		glNamedBufferStorage(m_HelpersBuf, COUNTER_COUNT * sizeof(uint32_t), nullptr, bufferFlags);
+		glNamedBufferStorage(m_TileIncrementsBuf, m_BufferCounters.tileIncrements.capacity * sizeof(TileIncrements), nullptr, bufferFlags);
+		m_OccludersCapacity = GetScreenTileCount();
+		glNamedBufferStorage(m_OccludersBuf, m_OccludersCapacity * sizeof(uint32_t), nullptr, bufferFlags);
+		glNamedBufferStorage(m_ScanPartialsBuf, GetScanGroupCount() * 2 * sizeof(uint32_t), nullptr, bufferFlags);
+		glNamedBufferStorage(m_WorklistsBuf, 8 * sizeof(uint32_t), nullptr, GL_DYNAMIC_STORAGE_BIT);
+		glNamedBufferStorage(m_VisiblePathsBuf, glm::max(Globals::PathsCount, 1u) * sizeof(uint32_t), nullptr, bufferFlags);
+		glNamedBufferStorage(m_VisibleCmdsBuf, glm::max(Globals::CommandsCount, 1u) * sizeof(uint32_t), nullptr, bufferFlags);
+
+		constexpr GLbitfield readbackFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		constexpr size_t readbackSize = READBACK_SECTIONS * COUNTER_COUNT * sizeof(uint32_t);
+		glNamedBufferStorage(m_CountersReadbackBuf, readbackSize, nullptr, readbackFlags);
+		m_MappedCounters = static_cast<const uint32_t*>(glMapNamedBufferRange(m_CountersReadbackBuf, 0, readbackSize, readbackFlags));
 
 		glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_ParamsBuf);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_PathsBuf);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_CmdsBuf);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_CmdTypesBuf);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_SimpleCmdsBuf);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_TilesBuf);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_VerticesBuf);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, m_AtlasBuf);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, m_HelpersBuf);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, m_TileIncrementsBuf);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, m_OccludersBuf);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, m_ScanPartialsBuf);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, m_WorklistsBuf);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, m_VisiblePathsBuf);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 14, m_VisibleCmdsBuf);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 15, m_CmdPathIndicesBuf);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 16, m_CmdPointsOffsetsBuf);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 17, m_CmdSimpleRangesBuf);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 18, m_PointsBuf);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 19, m_TransformedPointsBuf);
+
+		int maxWgCountX;
+		glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maxWgCountX);
+		m_MaxWgCountX = static_cast<uint32_t>(maxWgCountX);
 
 		m_FinalShader = Shader::Create(Filesystem::AssetsPath() / "shaders" / "Main.vert", Filesystem::AssetsPath() / "shaders" / "Main.frag");
 		m_ResetShader = Shader::CreateCompute(Filesystem::AssetsPath() / "shaders" / "Reset.comp");
@@ -112,10 +172,17 @@ namespace SvgRenderer {
 		m_CalcBboxShader = Shader::CreateCompute(Filesystem::AssetsPath() / "shaders" / "CalcBbox.comp");
 		m_PreFillShader = Shader::CreateCompute(Filesystem::AssetsPath() / "shaders" / "PreFill.comp");
 		m_FillShader = Shader::CreateCompute(Filesystem::AssetsPath() / "shaders" / "Fill.comp");
+		m_BackdropShader = Shader::CreateCompute(Filesystem::AssetsPath() / "shaders" / "Backdrop.comp");
+		m_OcclusionShader = Shader::CreateCompute(Filesystem::AssetsPath() / "shaders" / "Occlusion.comp");
 		m_CalcQuadsShader = Shader::CreateCompute(Filesystem::AssetsPath() / "shaders" / "CalcQuads.comp");
 		m_PrefixSumShader = Shader::CreateCompute(Filesystem::AssetsPath() / "shaders" / "PrefixSum.comp");
 		m_CoarseShader = Shader::CreateCompute(Filesystem::AssetsPath() / "shaders" / "Coarse.comp");
 		m_FineShader = Shader::CreateCompute(Filesystem::AssetsPath() / "shaders" / "Fine.comp");
+
+		if (m_Profiling)
+		{
+			m_Profiler.Init();
+		}
 	}
 
 	void GPUPipeline::Shutdown()
@@ -127,22 +194,169 @@ namespace SvgRenderer {
 
 		glDeleteBuffers(1, &m_ParamsBuf);
 		glDeleteBuffers(1, &m_PathsBuf);
-		glDeleteBuffers(1, &m_CmdsBuf);
+		glDeleteBuffers(1, &m_CmdTypesBuf);
+		glDeleteBuffers(1, &m_CmdPathIndicesBuf);
+		glDeleteBuffers(1, &m_CmdPointsOffsetsBuf);
+		glDeleteBuffers(1, &m_CmdSimpleRangesBuf);
+		glDeleteBuffers(1, &m_PointsBuf);
+		glDeleteBuffers(1, &m_TransformedPointsBuf);
 		glDeleteBuffers(1, &m_SimpleCmdsBuf);
 		glDeleteBuffers(1, &m_TilesBuf);
-		glDeleteBuffers(1, &m_AtlasBuf);
 		glDeleteBuffers(1, &m_HelpersBuf);
+		glDeleteBuffers(1, &m_TileIncrementsBuf);
+		glDeleteBuffers(1, &m_OccludersBuf);
+		glDeleteBuffers(1, &m_ScanPartialsBuf);
+		glDeleteBuffers(1, &m_WorklistsBuf);
+		glDeleteBuffers(1, &m_VisiblePathsBuf);
+		glDeleteBuffers(1, &m_VisibleCmdsBuf);
+
+		for (void* fence : m_ReadbackFences)
+		{
+			glDeleteSync(static_cast<GLsync>(fence));
+		}
+
+		glDeleteBuffers(1, &m_CountersReadbackBuf);
+
+		if (m_Profiling)
+		{
+			m_Profiler.Shutdown();
+		}
+	}
+
+	void GPUPipeline::EndStage(const char* name)
+	{
+		if (m_Profiling)
+		{
+			m_Profiler.EndStage(name);
+		}
+	}
+
+	void GPUPipeline::ReallocateBuffer(uint32_t& buffer, size_t size, uint32_t binding)
+	{
+		// Immutable storage cannot be resized, so the buffer is replaced, the content is not preserved
+		glDeleteBuffers(1, &buffer);
+		glCreateBuffers(1, &buffer);
+		glNamedBufferStorage(buffer, size, nullptr, 0);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+	}
+
+	void GPUPipeline::ReadCounters()
+	{
+		for (uint32_t i = 0; i < READBACK_SECTIONS; i++)
+		{
+			const uint32_t section = (m_ReadbackSection + i) % READBACK_SECTIONS;
+			void*& fence = m_ReadbackFences[section];
+			if (fence == nullptr)
+			{
+				continue;
+			}
+
+			const GLenum status = glClientWaitSync(static_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			{
+				// Still running, so are the later frames
+				return;
+			}
+
+			glDeleteSync(static_cast<GLsync>(fence));
+			fence = nullptr;
+
+			if (ApplyCounters(m_MappedCounters + section * COUNTER_COUNT))
+			{
+				m_HasOverflowed = true;
+			}
+		}
+	}
+
+	bool GPUPipeline::ApplyCounters(const uint32_t* counters)
+	{
+		// The shaders dropped what did not fit, the buffers hold only the data of a single frame,
+		// so they are just replaced and the frame is rendered again
+		bool hasGrown = false;
+		if (m_BufferCounters.simpleCommands.Require(counters[PRE_FLATTEN_COUNTER]))
+		{
+			ReallocateBuffer(m_SimpleCmdsBuf, m_BufferCounters.simpleCommands.capacity * sizeof(SimpleCommand), 3);
+			hasGrown = true;
+		}
+
+		if (m_BufferCounters.tiles.Require(counters[PRE_FILL_COUNTER]))
+		{
+			ReallocateBuffer(m_TilesBuf, m_BufferCounters.tiles.capacity * sizeof(Tile), 4);
+			hasGrown = true;
+		}
+
+		if (m_BufferCounters.tileIncrements.Require(counters[INCREMENTS_COUNTER]))
+		{
+			ReallocateBuffer(m_TileIncrementsBuf, m_BufferCounters.tileIncrements.capacity * sizeof(TileIncrements), 9);
+			hasGrown = true;
+		}
+
+		if (m_BufferCounters.quads.Require(counters[RENDER_INDICES_COUNT] / 6))
+		{
+			ReallocateBuffer(m_VerticesBuf, m_BufferCounters.quads.capacity * 4 * sizeof(Vertex), 5);
+			glVertexArrayVertexBuffer(m_Vao, 0, m_VerticesBuf, 0, sizeof(Vertex));
+
+			m_TileBuilder.GenerateIndices(m_BufferCounters.quads.capacity);
+			glNamedBufferData(m_Ibo, m_TileBuilder.indices.size() * sizeof(uint32_t), m_TileBuilder.indices.data(), GL_STATIC_DRAW);
+			hasGrown = true;
+		}
+
+		if (hasGrown)
+		{
+			SR_WARN("The scene buffers overflowed, they have grown and the frame is rendered again");
+		}
+
+		LogBufferCounters();
+		return hasGrown;
+	}
+
+	bool GPUPipeline::CheckOverflow()
+	{
+		ReadCounters();
+		return m_HasOverflowed;
+	}
+
+	void GPUPipeline::ResetWorklists()
+	{
+		// Empty worklists, the dispatches are { 0, 0, 1 } until PreFill.comp appends to them
+		constexpr uint32_t worklists[8] = { 0, 0, 1, 0, 0, 0, 1, 0 };
+		glNamedBufferSubData(m_WorklistsBuf, 0, sizeof(worklists), worklists);
 	}
 
 	void GPUPipeline::Render()
 	{
+		// Buffers are grown to the frames that already finished, this frame renders with them. When all
+		// the readback sections are in flight, the oldest frame has to finish before its section is reused
+		void*& fence = m_ReadbackFences[m_ReadbackSection];
+		if (fence != nullptr)
+		{
+			glClientWaitSync(static_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, std::numeric_limits<uint64_t>::max());
+		}
+
+		ReadCounters();
+		m_HasOverflowed = false;
+
 		float firstAlpha = 0.0f;
 		glClearTexImage(m_AlphaTexture, 0, GL_RED, GL_FLOAT, &firstAlpha);
 
 		float clearValueAlpha = 1.0f;
 		glClearTexSubImage(m_AlphaTexture, 0, 0, 0, 0, 1, 1, 1, GL_RED, GL_FLOAT, &clearValueAlpha);
 
+		// The window may be resized between the frames
+		const uint32_t screenTileCount = GetScreenTileCount();
+		if (screenTileCount > m_OccludersCapacity)
+		{
+			m_OccludersCapacity = screenTileCount;
+			ReallocateBuffer(m_OccludersBuf, m_OccludersCapacity * sizeof(uint32_t), 10);
+		}
+
+		glClearNamedBufferSubData(m_OccludersBuf, GL_R32UI, 0, screenTileCount * sizeof(uint32_t), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
 		Timer globalTimer;
+		if (m_Profiling)
+		{
+			m_Profiler.BeginFrame();
+		}
 
 		m_Params.globalTransform = Globals::GlobalTransform;
 		m_Params.screenWidth = Globals::WindowWidth;
@@ -150,221 +364,195 @@ namespace SvgRenderer {
 
 		glNamedBufferSubData(m_ParamsBuf, 0, sizeof(ParamsBuf), &m_Params);
 
-		int maxWgCountX, maxWgCountY, maxWgCountZ;
-		glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maxWgCountX);
-		glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 1, &maxWgCountY);
-		glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 2, &maxWgCountZ);
-
-		auto readData = [this]()
-		{
-			Timer timer;
-
-			glGetNamedBufferSubData(m_PathsBuf, 0, Globals::AllPaths.paths.size() * sizeof(PathRender), Globals::AllPaths.paths.data());
-			glGetNamedBufferSubData(m_CmdsBuf, 0, Globals::AllPaths.commands.size() * sizeof(PathRenderCmd), Globals::AllPaths.commands.data());
-			glGetNamedBufferSubData(m_SimpleCmdsBuf, 0, Globals::AllPaths.simpleCommands.size() * sizeof(SimpleCommand), Globals::AllPaths.simpleCommands.data());
-			glGetNamedBufferSubData(m_TilesBuf, 0, Globals::Tiles.tiles.size() * sizeof(Tile), Globals::Tiles.tiles.data());
-			glGetNamedBufferSubData(m_VerticesBuf, 0, m_TileBuilder.vertices.size() * sizeof(Vertex), m_TileBuilder.vertices.data());
-			glGetNamedBufferSubData(m_AtlasBuf, 0, m_TileBuilder.atlas.size() * sizeof(float), m_TileBuilder.atlas.data());
-
-			SR_WARN("Reading data: {0} ms", timer.ElapsedMillis());
-		};
+		// Steps after pre-fill run only over the visible paths and their commands, with the group counts
+		// written by the GPU, see PreFill.comp
+		ResetWorklists();
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_WorklistsBuf);
 
 		// 1.step: Reset all the data
 		{
-			Timer timer;
-
 			constexpr uint32_t wgSize = 256;
-			uint32_t threadsNeeded = std::max({ TILES_COUNT, VERTICES_COUNT, Globals::PathsCount });
-			uint32_t ySize = glm::ceil(threadsNeeded / static_cast<float>(maxWgCountX));
-			uint32_t xSize = ySize == 1 ? threadsNeeded : maxWgCountX;
+			uint32_t wgs = glm::max(glm::ceil(Globals::PathsCount / static_cast<float>(wgSize)), 1.0f);
+			uint32_t ySize = glm::ceil(wgs / static_cast<float>(m_MaxWgCountX));
+			uint32_t xSize = ySize == 1 ? wgs : m_MaxWgCountX;
 
 			m_ResetShader->Bind();
 			m_ResetShader->Dispatch(xSize, ySize, 1);
 			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-			glFinish();
 
-			SR_TRACE("Reseting: {0} ms", timer.ElapsedMillis());
+			EndStage("Reseting");
 		}
 
 		// 2.step: Transform the paths
 		{
-			Timer timer;
-
 			constexpr uint32_t wgSize = 256;
 			const uint32_t xSize = glm::ceil(Globals::CommandsCount / static_cast<float>(wgSize));
-			const uint32_t ySize = glm::max(glm::ceil(static_cast<float>(xSize) / maxWgCountX), 1.0f);
+			const uint32_t ySize = glm::max(glm::ceil(static_cast<float>(xSize) / m_MaxWgCountX), 1.0f);
 
 			m_TransformShader->Bind();
 			m_TransformShader->Dispatch(xSize, ySize, 1);
 			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-			glFinish();
 
-			SR_TRACE("Transforming: {0} ms", timer.ElapsedMillis());
+			EndStage("Transforming");
 		}
 
 		// 3.step: Calculate coarse bounding box
 		{
-			Timer timer;
-
 			constexpr uint32_t wgSize = 256;
-			const uint32_t ySize = glm::max(glm::ceil(static_cast<float>(Globals::PathsCount) / maxWgCountX), 1.0f);
-			const uint32_t xSize = ySize == 1 ? Globals::PathsCount : maxWgCountX;
+			const uint32_t ySize = glm::max(glm::ceil(static_cast<float>(Globals::PathsCount) / m_MaxWgCountX), 1.0f);
+			const uint32_t xSize = ySize == 1 ? Globals::PathsCount : m_MaxWgCountX;
 
 			m_CoarseBboxShader->Bind();
 			m_CoarseBboxShader->Dispatch(xSize, ySize, 1);
 			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-			glFinish();
 
-			SR_TRACE("Calculating Coarse BBOX: {0} ms", timer.ElapsedMillis());
+			EndStage("Calculating Coarse BBOX");
 		}
 
 		// 4.step: Calculate number of simple commands for each path command and their indices (for flattening)
 		{
-			Timer timer;
-
 			constexpr uint32_t wgSize = 256;
 			uint32_t wgs = glm::ceil(Globals::CommandsCount / static_cast<float>(wgSize));
-			uint32_t ySize = glm::ceil(wgs / static_cast<float>(maxWgCountX));
-			uint32_t xSize = ySize == 1 ? wgs : maxWgCountX;
+			uint32_t ySize = glm::ceil(wgs / static_cast<float>(m_MaxWgCountX));
+			uint32_t xSize = ySize == 1 ? wgs : m_MaxWgCountX;
 
 			m_PreFlattenShader->Bind();
 			m_PreFlattenShader->Dispatch(xSize, ySize, 1);
 			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-			glFinish();
 
-			SR_TRACE("Pre-flatten: {0} ms", timer.ElapsedMillis());
+			EndStage("Pre-flatten");
 		}
 
 		// 5.step: Actually flatten all the commands
 		{
-			Timer timer;
-
 			constexpr uint32_t wgSize = 256;
 			uint32_t wgs = glm::ceil(Globals::CommandsCount / static_cast<float>(wgSize));
-			uint32_t ySize = glm::ceil(wgs / static_cast<float>(maxWgCountX));
-			uint32_t xSize = ySize == 1 ? wgs : maxWgCountX;
+			uint32_t ySize = glm::ceil(wgs / static_cast<float>(m_MaxWgCountX));
+			uint32_t xSize = ySize == 1 ? wgs : m_MaxWgCountX;
 
 			m_FlattenShader->Bind();
 			m_FlattenShader->Dispatch(xSize, ySize, 1);
 			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-			glFinish();
 
-			SR_TRACE("Flattening: {0} ms", timer.ElapsedMillis());
+			EndStage("Flattening");
 		}
 
 		// 6.step: Calculating BBOX
 		{
-			Timer timer;
-
-			uint32_t ySize = glm::ceil(Globals::PathsCount / static_cast<float>(maxWgCountX));
-			uint32_t xSize = ySize == 1 ? Globals::PathsCount : maxWgCountX;
+			uint32_t ySize = glm::ceil(Globals::PathsCount / static_cast<float>(m_MaxWgCountX));
+			uint32_t xSize = ySize == 1 ? Globals::PathsCount : m_MaxWgCountX;
 
 			m_CalcBboxShader->Bind();
 			m_CalcBboxShader->Dispatch(xSize, ySize, 1);
 			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-			glFinish();
 
-			SR_TRACE("Calculating BBOX: {0} ms", timer.ElapsedMillis());
+			EndStage("Calculating BBOX");
 		}
 
 		// 7.step: Calculate correct tile indices for each path according to its bounding box
 		{
-			Timer timer;
-
-			uint32_t ySize = glm::ceil(Globals::PathsCount / static_cast<float>(maxWgCountX));
-			uint32_t xSize = ySize == 1 ? Globals::PathsCount : maxWgCountX;
+			uint32_t ySize = glm::ceil(Globals::PathsCount / static_cast<float>(m_MaxWgCountX));
+			uint32_t xSize = ySize == 1 ? Globals::PathsCount : m_MaxWgCountX;
 
 			m_PreFillShader->Bind();
 			m_PreFillShader->Dispatch(xSize, ySize, 1);
-			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-			glFinish();
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
 
-			SR_TRACE("Pre-Fill: {0} ms", timer.ElapsedMillis());
+			EndStage("Pre-Fill");
 		}
 
 		// 8.step: Filling
 		{
-			Timer timer;
+			m_FillShader->Bind();
+			m_FillShader->DispatchIndirect(CMDS_DISPATCH_OFFSET);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
-			uint32_t ySize = glm::ceil(Globals::CommandsCount / static_cast<float>(maxWgCountX));
-			uint32_t xSize = ySize == 1 ? Globals::CommandsCount : maxWgCountX;
+			EndStage("Fill");
+		}
 
-			m_FillShader->Bind();
-			m_FillShader->Dispatch(xSize, ySize, 1);
+		// 8.5.step: Resolve the winding deltas of the tile rows
+		{
+			m_BackdropShader->Bind();
+			m_BackdropShader->DispatchIndirect(PATHS_DISPATCH_OFFSET);
 			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-			glFinish();
 
-			SR_TRACE("Fill: {0} ms", timer.ElapsedMillis());
+			EndStage("Resolving backdrops");
 		}
 
-		// 9.step: Calculate correct count and indices for vertices of each path
+		// 8.6.step: Find the screen tiles hidden under opaque spans, their tiles and spans are not drawn
 		{
-			Timer timer;
+			m_OcclusionShader->Bind();
+			m_OcclusionShader->DispatchIndirect(PATHS_DISPATCH_OFFSET);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
-			uint32_t ySize = glm::ceil(Globals::PathsCount / static_cast<float>(maxWgCountX));
-			uint32_t xSize = ySize == 1 ? Globals::PathsCount : maxWgCountX;
+			EndStage("Occlusion");
+		}
 
+		// 9.step: Calculate correct count and indices for vertices of each path
+		{
 			m_CalcQuadsShader->Bind();
-			m_CalcQuadsShader->Dispatch(xSize, ySize, 1);
+			m_CalcQuadsShader->DispatchIndirect(PATHS_DISPATCH_OFFSET);
 			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-			glFinish();
 
-			SR_TRACE("Calculating quads: {0} ms", timer.ElapsedMillis());
+			EndStage("Calculating quads");
 		}
 
 		// 10.step: Prefix sum
 		{
-			Timer timer;
-
-			uint32_t ySize = glm::ceil(Globals::PathsCount / static_cast<float>(maxWgCountX));
-			uint32_t xSize = ySize == 1 ? Globals::PathsCount : maxWgCountX;
+			uint32_t wgs = GetScanGroupCount();
+			uint32_t ySize = glm::ceil(wgs / static_cast<float>(m_MaxWgCountX));
+			uint32_t xSize = ySize == 1 ? wgs : m_MaxWgCountX;
 
+			// Reduce-then-scan, see PrefixSum.comp for the passes
 			m_PrefixSumShader->Bind();
+			m_PrefixSumShader->SetUniformInt(0, 0);
+			m_PrefixSumShader->Dispatch(xSize, ySize, 1);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+			m_PrefixSumShader->SetUniformInt(0, 1);
 			m_PrefixSumShader->Dispatch(1, 1, 1);
 			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-			glFinish();
 
-			SR_TRACE("Prefix sum: {0} ms", timer.ElapsedMillis());
+			m_PrefixSumShader->SetUniformInt(0, 2);
+			m_PrefixSumShader->Dispatch(xSize, ySize, 1);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+			EndStage("Prefix sum");
 		}
 
 		// 11.step: Coarse
 		{
-			Timer timer;
-
-			uint32_t ySize = glm::ceil(Globals::PathsCount / static_cast<float>(maxWgCountX));
-			uint32_t xSize = ySize == 1 ? Globals::PathsCount : maxWgCountX;
-
 			m_CoarseShader->Bind();
-			m_CoarseShader->Dispatch(xSize, ySize, 1);
+			m_CoarseShader->DispatchIndirect(PATHS_DISPATCH_OFFSET);
 			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-			glFinish();
 
-			SR_TRACE("Coarse: {0} ms", timer.ElapsedMillis());
+			EndStage("Coarse");
 		}
 
 		// 12.step: Fine
 		{
-			Timer timer;
-
-			uint32_t ySize = glm::ceil(Globals::PathsCount / static_cast<float>(maxWgCountX));
-			uint32_t xSize = ySize == 1 ? Globals::PathsCount : maxWgCountX;
-
 			m_FineShader->Bind();
-			glBindImageTexture(0, m_AlphaTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
-			m_FineShader->Dispatch(xSize, ySize, 1);
-			glMemoryBarrier(GL_ALL_BARRIER_BITS);
-			glFinish();
-
-			SR_TRACE("Fine: {0} ms", timer.ElapsedMillis());
-
-			//readData();
+			glBindImageTexture(0, m_AlphaTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+			m_FineShader->DispatchIndirect(PATHS_DISPATCH_OFFSET);
+			// Vertices, atlas and the indirect draw are consumed by the final pass, the atlas
+			// and the occluders are also cleared at the start of the next frame
+			glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_COMMAND_BARRIER_BIT
+				| GL_TEXTURE_UPDATE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+			EndStage("Fine");
 		}
 
-		//glNamedBufferData(m_Vbo, m_TileBuilder.vertices.size() * sizeof(Vertex), m_TileBuilder.vertices.data(), GL_STATIC_DRAW);
+		// Counters of this frame, the copy is ordered after fine by its barrier
+		glCopyNamedBufferSubData(m_HelpersBuf, m_CountersReadbackBuf, 0, m_ReadbackSection * COUNTER_COUNT * sizeof(uint32_t), COUNTER_COUNT * sizeof(uint32_t));
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_ReadbackSection = (m_ReadbackSection + 1) % READBACK_SECTIONS;
 
-		//glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		//glTextureSubImage2D(m_AlphaTexture, 0, 0, 0, ATLAS_SIZE, ATLAS_SIZE, GL_RED, GL_FLOAT, m_TileBuilder.atlas.data());
+		if (m_Profiling)
+		{
+			m_Profiler.EndFrame();
+		}
 
+		// Without profiling nothing waits for the GPU here, so this is mostly the time to submit the work
 		SR_INFO("Total execution time: {0} ms", globalTimer.ElapsedMillis());
 
 		static uint32_t totalTime = 0;
@@ -3,6 +3,9 @@
 #include "Renderer/Pipeline/Pipeline.h"
 #include "Renderer/Shader.h"
 #include "Renderer/TileBuilder.h"
+#include "Renderer/GPUProfiler.h"
+
+#include <array>
 
 namespace SvgRenderer {
 
@@ -15,17 +18,26 @@ namespace SvgRenderer {
 			uint32_t screenHeight;
 		};
 	public:
+		// With profiling, every stage is timed by timestamp queries that are read back a few frames later,
+		// otherwise all the dispatches are issued back to back with only the barriers they need
+		GPUPipeline(bool profiling = false)
+			: m_Profiling(profiling) {}
+
 		virtual void Init() override;
 		virtual void Shutdown() override;
 
 		virtual void Render() override;
 		virtual void Final() override;
+
+		virtual bool CheckOverflow() override;
 	private:
-		template <class FwdIt, class Fn>
-		void ForEach(FwdIt first, FwdIt last, Fn func) noexcept
-		{
-			std::for_each(std::execution::par, first, last, func);
-		}
+		void ReallocateBuffer(uint32_t& buffer, size_t size, uint32_t binding);
+		// Applies the counters of the frames whose copies have landed, oldest first, never waits
+		void ReadCounters();
+		// Grows the buffers to the counters of a finished frame, returns true if any of them has grown
+		bool ApplyCounters(const uint32_t* counters);
+		void ResetWorklists();
+		void EndStage(const char* name);
 	private:
 		TileBuilder m_TileBuilder;
 		uint32_t m_Ibo = 0, m_Vao = 0, m_AlphaTexture = 0;
@@ -41,14 +53,32 @@ namespace SvgRenderer {
 		Ref<Shader> m_CalcBboxShader;
 		Ref<Shader> m_PreFillShader;
 		Ref<Shader> m_FillShader;
+		Ref<Shader> m_BackdropShader;
+		Ref<Shader> m_OcclusionShader;
 		Ref<Shader> m_CalcQuadsShader;
 		Ref<Shader> m_PrefixSumShader;
 		Ref<Shader> m_CoarseShader;
 		Ref<Shader> m_FineShader;
 
-		uint32_t m_ParamsBuf, m_PathsBuf, m_CmdsBuf, m_SimpleCmdsBuf, m_TilesBuf, m_VerticesBuf, m_AtlasBuf, m_HelpersBuf;
+		uint32_t m_ParamsBuf, m_PathsBuf, m_SimpleCmdsBuf, m_TilesBuf, m_VerticesBuf, m_HelpersBuf, m_TileIncrementsBuf, m_OccludersBuf, m_ScanPartialsBuf;
+		uint32_t m_WorklistsBuf, m_VisiblePathsBuf, m_VisibleCmdsBuf;
+		uint32_t m_CmdTypesBuf, m_CmdPathIndicesBuf, m_CmdPointsOffsetsBuf, m_CmdSimpleRangesBuf, m_PointsBuf, m_TransformedPointsBuf;
+		uint32_t m_OccludersCapacity = 0;
+		uint32_t m_MaxWgCountX = 0;
+
+		// The counters of the helpers buffer are copied into a persistently mapped buffer at the end of every frame,
+		// and checked once the fence of the copy is signaled, so the CPU does not wait for them
+		static constexpr uint32_t READBACK_SECTIONS = 3;
+		uint32_t m_CountersReadbackBuf = 0;
+		const uint32_t* m_MappedCounters = nullptr;
+		uint32_t m_ReadbackSection = 0; // Section the next frame copies its counters to, the oldest one in flight
+		std::array<void*, READBACK_SECTIONS> m_ReadbackFences{}; // GLsync of the copy into each section
+		bool m_HasOverflowed = false; // A finished frame did not fit, the buffers have grown since the last render
 
 		ParamsBuf m_Params;
+
+		bool m_Profiling;
+		GPUProfiler m_Profiler;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,24 @@
+#include "Renderer/Pipeline/Pipeline.h"
+
+namespace SvgRenderer {
+
+	void Pipeline::LogBufferCounters() const
+	{
+		auto LogCounter = [](const char* name, const BufferCounter& counter)
+		{
+			if (counter.HasOverflowed())
+			{
+				SR_WARN("{0}: overflowed, {1} requested, {2} peak, {3} capacity, the elements past the capacity were dropped", name, counter.used, counter.peak, counter.capacity);
+				return;
+			}
+
+			SR_TRACE("{0}: {1} used, {2} peak, {3} capacity", name, counter.used, counter.peak, counter.capacity);
+		};
+
+		LogCounter("Simple commands", m_BufferCounters.simpleCommands);
+		LogCounter("Tiles", m_BufferCounters.tiles);
+		LogCounter("Tile increments", m_BufferCounters.tileIncrements);
+		LogCounter("Quads", m_BufferCounters.quads);
+	}
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Renderer/Pipeline/BufferCounter.h"
+
 namespace SvgRenderer {
 
 	class Pipeline
@@ -12,6 +14,17 @@ namespace SvgRenderer {
 
 		virtual void Render() = 0;
 		virtual void Final() = 0;
+
+		// True if a scene buffer overflowed in the last rendered frame and has grown since, so the frame
+		// has to be rendered again. Only pipelines that learn their usage a few frames late can report it
+		virtual bool CheckOverflow() { return false; }
+
+		// Usage of the scene buffers in the last frame, and the peak usage over all the frames
+		const BufferCounters& GetBufferCounters() const { return m_BufferCounters; }
+	protected:
+		void LogBufferCounters() const;
+	protected:
+		BufferCounters m_BufferCounters;
 	};
 
 }
@@ -0,0 +1,76 @@
+#include "PointTransform.h"
+
+// SR_DISABLE_SIMD leaves only the scalar path, the benchmarks check the vector paths against it
+#if defined(SR_DISABLE_SIMD)
+#elif defined(__AVX2__)
+	#define SR_AVX2
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define SR_SSE2
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+	#define SR_NEON
+	#include <arm_neon.h>
+#endif
+
+namespace SvgRenderer {
+
+	// The points are interleaved as x0 y0 x1 y1 ..., so with the coefficients interleaved the same way,
+	// x' y' = (x y) * (a d) + (y x) * (c b) + (e f), the swap of the neighbouring lanes is the only shuffle needed
+	void TransformPoints(const AffineTransform& transform, const glm::vec2* src, glm::vec2* dst, uint32_t count)
+	{
+		const float* in = &src[0].x;
+		float* out = &dst[0].x;
+		uint32_t i = 0;
+
+#if defined(SR_AVX2)
+		const __m256 diag = _mm256_setr_ps(transform.a, transform.d, transform.a, transform.d, transform.a, transform.d, transform.a, transform.d);
+		const __m256 cross = _mm256_setr_ps(transform.c, transform.b, transform.c, transform.b, transform.c, transform.b, transform.c, transform.b);
+		const __m256 translation = _mm256_setr_ps(transform.e, transform.f, transform.e, transform.f, transform.e, transform.f, transform.e, transform.f);
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256 p0 = _mm256_loadu_ps(in + i * 2);
+			const __m256 p1 = _mm256_loadu_ps(in + i * 2 + 8);
+			const __m256 r0 = _mm256_fmadd_ps(p0, diag, _mm256_fmadd_ps(_mm256_permute_ps(p0, 0b10110001), cross, translation));
+			const __m256 r1 = _mm256_fmadd_ps(p1, diag, _mm256_fmadd_ps(_mm256_permute_ps(p1, 0b10110001), cross, translation));
+			_mm256_storeu_ps(out + i * 2, r0);
+			_mm256_storeu_ps(out + i * 2 + 8, r1);
+		}
+#elif defined(SR_SSE2)
+		const __m128 diag = _mm_setr_ps(transform.a, transform.d, transform.a, transform.d);
+		const __m128 cross = _mm_setr_ps(transform.c, transform.b, transform.c, transform.b);
+		const __m128 translation = _mm_setr_ps(transform.e, transform.f, transform.e, transform.f);
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 p0 = _mm_loadu_ps(in + i * 2);
+			const __m128 p1 = _mm_loadu_ps(in + i * 2 + 4);
+			const __m128 r0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, diag), _mm_mul_ps(_mm_shuffle_ps(p0, p0, 0b10110001), cross)), translation);
+			const __m128 r1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p1, diag), _mm_mul_ps(_mm_shuffle_ps(p1, p1, 0b10110001), cross)), translation);
+			_mm_storeu_ps(out + i * 2, r0);
+			_mm_storeu_ps(out + i * 2 + 4, r1);
+		}
+#elif defined(SR_NEON)
+		const float diagValues[4] = { transform.a, transform.d, transform.a, transform.d };
+		const float crossValues[4] = { transform.c, transform.b, transform.c, transform.b };
+		const float translationValues[4] = { transform.e, transform.f, transform.e, transform.f };
+		const float32x4_t diag = vld1q_f32(diagValues);
+		const float32x4_t cross = vld1q_f32(crossValues);
+		const float32x4_t translation = vld1q_f32(translationValues);
+		for (; i + 4 <= count; i += 4)
+		{
+			const float32x4_t p0 = vld1q_f32(in + i * 2);
+			const float32x4_t p1 = vld1q_f32(in + i * 2 + 4);
+			const float32x4_t r0 = vmlaq_f32(vmlaq_f32(translation, vrev64q_f32(p0), cross), p0, diag);
+			const float32x4_t r1 = vmlaq_f32(vmlaq_f32(translation, vrev64q_f32(p1), cross), p1, diag);
+			vst1q_f32(out + i * 2, r0);
+			vst1q_f32(out + i * 2 + 4, r1);
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			dst[i] = transform.Apply(src[i]);
+		}
+	}
+
+}
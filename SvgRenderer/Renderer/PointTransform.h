@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace SvgRenderer {
+
+	// 2D affine transform, x' = a * x + c * y + e, y' = b * x + d * y + f
+	struct AffineTransform
+	{
+		float a, b, c, d, e, f;
+
+		// Same result as (transform * glm::vec4(point, 1.0f, 1.0f)).xy, so the z column is folded into the translation
+		static AffineTransform FromMat4(const glm::mat4& transform)
+		{
+			return AffineTransform{
+				.a = transform[0][0],
+				.b = transform[0][1],
+				.c = transform[1][0],
+				.d = transform[1][1],
+				.e = transform[2][0] + transform[3][0],
+				.f = transform[2][1] + transform[3][1]
+			};
+		}
+
+		glm::vec2 Apply(const glm::vec2& point) const
+		{
+			return glm::vec2(a * point.x + c * point.y + e, b * point.x + d * point.y + f);
+		}
+	};
+
+	// Transforms count points from src into dst, 8 points at a time with AVX2, 4 with SSE2 or NEON,
+	// and the rest one by one. src and dst may be the same array
+	void TransformPoints(const AffineTransform& transform, const glm::vec2* src, glm::vec2* dst, uint32_t count);
+
+}
@@ -1,22 +1,15 @@
 #include "Rasterizer.h"
 
+#include "Renderer/CoverageKernel.h"
 #include "Renderer/Flattening.h"
+#include "Renderer/LineCells.h"
 
+#include <atomic>
 #include <cassert>
 #include <numeric>
-#include <execution>
 
 namespace SvgRenderer {
 
-	static int8_t sign(float value)
-	{
-		if (value > 0)
-			return 1;
-		else if (value < 0)
-			return -1;
-		return 0;
-	}
-
 	Rasterizer::Rasterizer(uint32_t pathIndex)
 		: m_PathIndex(pathIndex)
 	{
@@ -40,125 +33,171 @@ namespace SvgRenderer {
 
 	void Rasterizer::LineTo(const glm::vec2& last, const glm::vec2& point)
 	{
-		if (point != last)
+		uint32_t prevTileY = GetTileCoordY(glm::floor(last.y));
+
+		// Handle tile boundaries, x and y is the cell the walk moved to
+		auto crossTileRow = [this, &prevTileY](int32_t x, int32_t y)
 		{
-			uint32_t prevTileY = GetTileCoordY(glm::floor(last.y));
-
-			int32_t xDir = sign(point.x - last.x);
-			int32_t yDir = sign(point.y - last.y);
-			float dtdx = 1.0f / (point.x - last.x);
-			float dtdy = 1.0f / (point.y - last.y);
-			int32_t x = glm::floor(last.x); // Convert to int
-			int32_t y = glm::floor(last.y);  // Convert to int
-			float rowt0 = 0.0f;
-			float colt0 = 0.0f;
-
-			float rowt1;
-			if (last.y == point.y)
+			int32_t tileY = GetTileCoordY(y);
+			if (tileY != prevTileY)
 			{
-				rowt1 = std::numeric_limits<float>::max();
+				int32_t v1 = glm::floor(static_cast<float>(x) / TILE_SIZE) - m_TileStartX; // Find out which tile index on x-axis are we on
+				int8_t v2 = tileY - prevTileY; // Are we moving from top to bottom, or bottom to top? (1 = from lower tile to higher tile, -1 = opposite)
+				uint32_t currentTileY = v2 == 1 ? prevTileY : tileY;
+
+				// All the tiles left of the crossing get the winding, but only the delta is stored in the tile
+				// just before the crossing, ResolveBackdrops() spreads it over the row afterwards
+				v1 = glm::clamp(v1, 0, static_cast<int32_t>(m_TileCountX));
+				if (v1 > 0 && currentTileY < m_TileCountY)
+				{
+					std::atomic_ref(GetTileFromRelativePos(v1 - 1, currentTileY).winding).fetch_add(v2, std::memory_order_relaxed);
+				}
+
+				prevTileY = tileY;
 			}
-			else
+		};
+
+		ForEachLineCell(last, point, [this, &crossTileRow](int32_t x, int32_t y, float area, float height)
+		{
+			crossTileRow(x, y);
+
+			int32_t relativeX = glm::abs(x % TILE_SIZE);
+			int32_t relativeY = glm::abs(y % TILE_SIZE);
+			if (x < 0)
 			{
-				float nextY = point.y > last.y ? y + 1 : y;
-				rowt1 = glm::min((dtdy * (nextY - last.y)), 1.0f);
+				relativeX = TILE_SIZE - relativeX - 1;
 			}
-
-			float colt1;
-			if (last.x == point.x)
+			if (y < 0)
 			{
-				colt1 = std::numeric_limits<float>::max();
+				relativeY = TILE_SIZE - relativeY - 1;
 			}
-			else
+
+			// The pool may be exhausted
+			const uint32_t incrementsIndex = AcquireIncrements(GetTileFromWindowPos(x, y));
+			if (incrementsIndex != TileIncrementsPool::INVALID_INDEX)
 			{
-				float nextX = point.x > last.x ? x + 1 : x;
-				colt1 = glm::min((dtdx * (nextX - last.x)), 1.0f);
+				// Lines of the same path are filled in parallel, so the cells are accumulated atomically
+				Increment& increment = Globals::Tiles.increments[incrementsIndex][relativeY * TILE_SIZE + relativeX];
+				std::atomic_ref(increment.area).fetch_add(int32_t(area * 1000.0f), std::memory_order_relaxed);
+				std::atomic_ref(increment.height).fetch_add(int32_t(height * 1000.0f), std::memory_order_relaxed);
 			}
+		});
+
+		// The end of the line may lie on the edge of the last cell, so the row of the end point is checked as well
+		crossTileRow(glm::floor(point.x), glm::floor(point.y));
+	}
+
+	uint32_t Rasterizer::AcquireIncrements(Tile& tile)
+	{
+		std::atomic_ref<uint32_t> tileIncrementsIndex(tile.incrementsIndex);
+		uint32_t incrementsIndex = tileIncrementsIndex.load(std::memory_order_acquire);
+		if (incrementsIndex != TileIncrementsPool::INVALID_INDEX)
+		{
+			return incrementsIndex;
+		}
+
+		const uint32_t newIndex = Globals::Tiles.increments.Allocate();
+		if (newIndex == TileIncrementsPool::INVALID_INDEX)
+		{
+			return TileIncrementsPool::INVALID_INDEX;
+		}
 
-			float xStep = glm::abs(dtdx);
-			float yStep = glm::abs(dtdy);
+		// If some other thread was faster, use its increments, ours are just wasted
+		if (tileIncrementsIndex.compare_exchange_strong(incrementsIndex, newIndex, std::memory_order_acq_rel, std::memory_order_acquire))
+		{
+			return newIndex;
+		}
+
+		return incrementsIndex;
+	}
 
-			while (true)
+	void Rasterizer::ResolveBackdrops()
+	{
+		// Suffix sum of the winding deltas in each row, so every tile ends up with the windings
+		// of all the crossings right of it
+		for (uint32_t y = 0; y < m_TileCountY; y++)
+		{
+			int32_t winding = 0;
+			for (int32_t x = m_TileCountX - 1; x >= 0; x--)
 			{
-				float t0 = glm::max(rowt0, colt0);
-				float t1 = glm::min(rowt1, colt1);
-				glm::vec2 p0 = (1.0f - t0) * last + t0 * point;
-				glm::vec2 p1 = (1.0f - t1) * last + t1 * point;
-				float height = p1.y - p0.y;
-				float right = x + 1;
-				float area = 0.5f * height * ((right - p0.x) + (right - p1.x));
-
-				int32_t relativeX = glm::abs(x % TILE_SIZE);
-				int32_t relativeY = glm::abs(y % TILE_SIZE);
-				if (x < 0)
-				{
-					relativeX = TILE_SIZE - relativeX - 1;
-				}
-				if (y < 0)
-				{
-					relativeY = TILE_SIZE - relativeY - 1;
-				}
+				Tile& tile = GetTileFromRelativePos(x, y);
+				winding += tile.winding;
+				tile.winding = winding;
+			}
+		}
+	}
 
-				{
-					std::lock_guard lock(m_Mut1);
-					GetTileFromWindowPos(x, y).increments[relativeY * TILE_SIZE + relativeX].area += int32_t(area * 1000.0f);
-					GetTileFromWindowPos(x, y).increments[relativeY * TILE_SIZE + relativeX].height += int32_t(height * 1000.0f);
-					GetTileFromWindowPos(x, y).hasIncrements = true;
-				}
+	void Rasterizer::MarkOccluders()
+	{
+		const PathRender& path = Globals::AllPaths.paths[m_PathIndex];
+		if (path.color[3] != 255)
+		{
+			return;
+		}
 
-				// Advance to the next scanline
-				if (rowt1 < colt1)
-				{
-					rowt0 = rowt1;
-					rowt1 = glm::min((rowt1 + yStep), 1.0f);
-					y += yDir;
-				}
-				else
-				{
-					colt0 = colt1;
-					colt1 = glm::min((colt1 + xStep), 1.0f);
-					x += xDir;
-				}
+		OcclusionContainer& occlusion = Globals::Occlusion;
+		for (uint32_t y = 0; y < m_TileCountY; y++)
+		{
+			const int32_t screenTileY = m_TileStartY + static_cast<int32_t>(y);
+			if (screenTileY < 0 || screenTileY >= static_cast<int32_t>(occlusion.tileCountY))
+			{
+				continue;
+			}
 
-				// Reset coordinates if a scanline is completed
-				if (rowt0 == 1.0f || colt0 == 1.0f)
+			// Same spans as in Coarse(), between two tiles with increments, if the left one is inside by the fill rule
+			int32_t prevX = -1;
+			for (int32_t x = 0; x < static_cast<int32_t>(m_TileCountX); x++)
+			{
+				if (!GetTileFromRelativePos(x, y).HasIncrements())
 				{
-					x = glm::floor(point.x);
-					y = glm::floor(point.y);
+					continue;
 				}
 
-				// Handle tile boundaries
-				int32_t tileY = GetTileCoordY(y);
-				if (tileY != prevTileY)
+				if (prevX >= 0 && IsInside(GetTileFromRelativePos(prevX, y).winding, path.fillRule))
 				{
-					int32_t v1 = GetTileCoordX(x); // Find out which tile index on x-axis are we on
-					int8_t v2 = tileY - prevTileY; // Are we moving from top to bottom, or bottom to top? (1 = from lower tile to higher tile, -1 = opposite)
-					uint32_t currentTileY = v2 == 1 ? prevTileY : tileY;
-
-					const PathRender& path = Globals::AllPaths.paths[m_PathIndex];
-					uint32_t tileCount = path.endTileIndex - path.startTileIndex + 1;
-					uint32_t currentIndex = glm::max(glm::min(GetTileIndexFromRelativePos(v1, currentTileY), static_cast<uint32_t>(tileCount - 1)), 0u);
-
+					const int32_t firstTileX = glm::max(m_TileStartX + prevX + 1, 0);
+					const int32_t lastTileX = glm::min(m_TileStartX + x - 1, static_cast<int32_t>(occlusion.tileCountX) - 1);
+					for (int32_t tileX = firstTileX; tileX <= lastTileX; tileX++)
 					{
-						std::lock_guard lock(m_Mut2);
-						for (uint32_t i = 0; i < currentIndex; i++)
+						std::atomic_ref occluder(occlusion.occluders[screenTileY * occlusion.tileCountX + tileX]);
+						uint32_t current = occluder.load(std::memory_order_relaxed);
+						while (current < m_PathIndex && !occluder.compare_exchange_weak(current, m_PathIndex, std::memory_order_relaxed))
 						{
-							Globals::Tiles.tiles[i + path.startTileIndex].winding += v2;
 						}
 					}
-
-					prevTileY = tileY;
 				}
 
-				// Break the loop if we are on the end
-				if (rowt0 == 1.0f || colt0 == 1.0f)
-				{
-					break;
-				}
+				prevX = x;
 			}
 		}
 	}
 
+	bool Rasterizer::IsOccluded(int32_t tileX, int32_t tileY) const
+	{
+		const OcclusionContainer& occlusion = Globals::Occlusion;
+		if (tileX < 0 || tileY < 0 || tileX >= static_cast<int32_t>(occlusion.tileCountX) || tileY >= static_cast<int32_t>(occlusion.tileCountY))
+		{
+			return false;
+		}
+
+		return occlusion.occluders[tileY * occlusion.tileCountX + tileX] > m_PathIndex;
+	}
+
+	bool Rasterizer::TrimOccludedSpan(int32_t& firstTileX, int32_t& lastTileX, int32_t tileY) const
+	{
+		while (firstTileX <= lastTileX && IsOccluded(firstTileX, tileY))
+		{
+			firstTileX++;
+		}
+
+		while (lastTileX >= firstTileX && IsOccluded(lastTileX, tileY))
+		{
+			lastTileX--;
+		}
+
+		return firstTileX <= lastTileX;
+	}
+
 	std::pair<uint32_t, uint32_t> Rasterizer::CalculateNumberOfQuads()
 	{
 		const PathRender& path = Globals::AllPaths.paths[m_PathIndex];
@@ -169,7 +208,7 @@ namespace SvgRenderer {
 		for (uint32_t i = 0; i < tileCount; i++)
 		{
 			Tile& tile = Globals::Tiles.tiles[i + path.startTileIndex];
-			if (!tile.hasIncrements)
+			if (!tile.HasIncrements())
 			{
 				continue;
 			}
@@ -180,7 +219,7 @@ namespace SvgRenderer {
 
 			for (uint32_t j = i + 1; j < tileCount && GetTileYFromAbsoluteIndex(j) == tileY; j++)
 			{
-				if (Globals::Tiles.tiles[j + path.startTileIndex].hasIncrements)
+				if (Globals::Tiles.tiles[j + path.startTileIndex].HasIncrements())
 				{
 					nextTile = &Globals::Tiles.tiles[j + path.startTileIndex];
 					nextTileX = GetTileXFromAbsoluteIndex(j);
@@ -194,11 +233,16 @@ namespace SvgRenderer {
 				const int32_t tileX = GetTileXFromAbsoluteIndex(i);
 				int32_t nextTileX = GetTileXFromAbsoluteIndex(tile.nextTileIndex - path.startTileIndex);
 				int32_t width = nextTileX - tileX - 1;
-				// If the winding is nonzero, span the whole tile
+				// If the winding is inside by the fill rule, span the whole tile
 				if (tileX + width + 1 >= 0 && tileY >= 0 && tileY <= glm::ceil(static_cast<float>(Globals::WindowHeight) / TILE_SIZE)
-				    && GetTileFromRelativePos(tileX - m_TileStartX, tileY - m_TileStartY).winding != 0)
+				    && IsInside(GetTileFromRelativePos(tileX - m_TileStartX, tileY - m_TileStartY).winding, path.fillRule))
 				{
-					coarseQuadCount++;
+					int32_t firstTileX = tileX + 1;
+					int32_t lastTileX = nextTileX - 1;
+					if (TrimOccludedSpan(firstTileX, lastTileX, tileY))
+					{
+						coarseQuadCount++;
+					}
 				}
 			}
 		}
@@ -208,14 +252,15 @@ namespace SvgRenderer {
 		for (uint32_t i = 0; i < tileCount; i++)
 		{
 			const Tile& tile = Globals::Tiles.tiles[i + path.startTileIndex];
-			if (!tile.hasIncrements)
+			if (!tile.HasIncrements())
 			{
 				continue;
 			}
 
 			int32_t tileX = GetTileXFromAbsoluteIndex(i);
 			int32_t tileY = GetTileYFromAbsoluteIndex(i);
-			if (tileX >= 0 && tileY >= 0 && tileX <= glm::ceil(static_cast<float>(Globals::WindowWidth) / TILE_SIZE) && tileY <= glm::ceil(static_cast<float>(Globals::WindowHeight) / TILE_SIZE))
+			if (tileX >= 0 && tileY >= 0 && tileX <= glm::ceil(static_cast<float>(Globals::WindowWidth) / TILE_SIZE) && tileY <= glm::ceil(static_cast<float>(Globals::WindowHeight) / TILE_SIZE)
+			    && !IsOccluded(tileX, tileY))
 			{
 				fineQuadCount++;
 			}
@@ -233,7 +278,7 @@ namespace SvgRenderer {
 		for (uint32_t i = 0; i < tileCount; i++)
 		{
 			const Tile& tile = Globals::Tiles.tiles[i + path.startTileIndex];
-			if (!tile.hasIncrements)
+			if (!tile.HasIncrements())
 			{
 				continue;
 			}
@@ -245,11 +290,17 @@ namespace SvgRenderer {
 				const int32_t tileY = GetTileYFromAbsoluteIndex(i);
 				int32_t nextTileX = GetTileXFromAbsoluteIndex(tile.nextTileIndex - path.startTileIndex);
 				int32_t width = nextTileX - tileX - 1;
-				// If the winding is nonzero, span the whole tile
+				// If the winding is inside by the fill rule, span the whole tile
 				if (tileX + width + 1 >= 0 && tileY >= 0 && tileY <= glm::ceil(static_cast<float>(Globals::WindowHeight) / TILE_SIZE)
-				    && GetTileFromRelativePos(tileX - m_TileStartX, tileY - m_TileStartY).winding != 0)
+				    && IsInside(GetTileFromRelativePos(tileX - m_TileStartX, tileY - m_TileStartY).winding, path.fillRule))
 				{
-					builder.Span((tileX + 1) * TILE_SIZE, tileY * TILE_SIZE, width * TILE_SIZE, quadIndex++, Globals::AllPaths.paths[m_PathIndex].color);
+					// Only the ends of the span are trimmed, so it stays a single quad
+					int32_t firstTileX = tileX + 1;
+					int32_t lastTileX = nextTileX - 1;
+					if (TrimOccludedSpan(firstTileX, lastTileX, tileY))
+					{
+						builder.Span(firstTileX * TILE_SIZE, tileY * TILE_SIZE, (lastTileX - firstTileX + 1) * TILE_SIZE, quadIndex++, Globals::AllPaths.paths[m_PathIndex].color);
+					}
 				}
 			}
 		}
@@ -257,9 +308,10 @@ namespace SvgRenderer {
 
 	void Rasterizer::Fine(TileBuilder& builder)
 	{
-		std::array<float, TILE_SIZE * TILE_SIZE> areas{};
-		std::array<float, TILE_SIZE * TILE_SIZE> heights{};
-		std::array<float, TILE_SIZE> coverage{};
+		// Coverage entering each row of the tile from the left, in the fixed point of the increments
+		std::array<int32_t, TILE_SIZE> carry{};
+		// Tiles that are not drawn are still accumulated for the carry, their coverage goes here
+		std::array<uint8_t, TILE_SIZE * TILE_SIZE> discarded;
 
 		const PathRender& path = Globals::AllPaths.paths[m_PathIndex];
 		uint32_t tileCount = path.endTileIndex - path.startTileIndex + 1;
@@ -269,54 +321,31 @@ namespace SvgRenderer {
 		for (uint32_t i = 0; i < tileCount; i++)
 		{
 			const Tile& tile = Globals::Tiles.tiles[i + path.startTileIndex];
-			if (!tile.hasIncrements)
+			if (!tile.HasIncrements())
 			{
 				continue;
 			}
 
-			for (int32_t y = 0; y < TILE_SIZE; y++)
-			{
-				for (int32_t x = 0; x < TILE_SIZE; x++)
-				{
-					const Increment& increment = tile.increments[y * TILE_SIZE + x];
-					// Loop over each increment inside the tile
-					areas[y * TILE_SIZE + x] = increment.area / 1000.0f; // Just simple increment for area
-					heights[y * TILE_SIZE + x] = increment.height / 1000.0f; // Just simple increment for height
-				}
-			}
-
-			std::array<uint8_t, TILE_SIZE * TILE_SIZE> tileData;
-
-			// For each y-coord in the tile
-			for (uint32_t y = 0; y < TILE_SIZE; y++)
-			{
-				float accum = coverage[y];
-
-				// For each x-coord in the tile
-				for (uint32_t x = 0; x < TILE_SIZE; x++)
-				{
-					tileData[y * TILE_SIZE + x] = glm::min(glm::abs(accum + areas[y * TILE_SIZE + x]) * 256.0f, 255.0f);
-					accum += heights[y * TILE_SIZE + x];
-				}
-
-				coverage[y] = accum;
-			}
+			const TileIncrements& increments = Globals::Tiles.increments[tile.incrementsIndex];
 
 			int32_t tileX = GetTileXFromAbsoluteIndex(i);
 			int32_t tileY = GetTileYFromAbsoluteIndex(i);
-			if (tileX >= 0 && tileY >= 0 && tileX <= glm::ceil(static_cast<float>(Globals::WindowWidth) / TILE_SIZE) && tileY <= glm::ceil(static_cast<float>(Globals::WindowHeight) / TILE_SIZE))
+			if (tileX >= 0 && tileY >= 0 && tileX <= glm::ceil(static_cast<float>(Globals::WindowWidth) / TILE_SIZE) && tileY <= glm::ceil(static_cast<float>(Globals::WindowHeight) / TILE_SIZE)
+			    && !IsOccluded(tileX, tileY))
 			{
-				builder.Tile(tileX * TILE_SIZE, tileY * TILE_SIZE, tileData, tileIndex++, quadIndex++, Globals::AllPaths.paths[m_PathIndex].color);
+				AccumulateCoverage(increments.data(), carry.data(), path.fillRule, builder.GetAtlasTile(tileIndex), ATLAS_SIZE);
+				builder.Tile(tileX * TILE_SIZE, tileY * TILE_SIZE, tileIndex++, quadIndex++, Globals::AllPaths.paths[m_PathIndex].color);
+			}
+			else
+			{
+				AccumulateCoverage(increments.data(), carry.data(), path.fillRule, discarded.data(), TILE_SIZE);
 			}
-
-			std::fill(areas.begin(), areas.end(), 0.0f);
-			std::fill(heights.begin(), heights.end(), 0.0f);
 
 			// Next active tile in the same y-coord, same as the previous one, could be optimized and only done once
 			Tile* nextTile = tile.nextTileIndex == std::numeric_limits<uint32_t>::max() ? nullptr : &Globals::Tiles.tiles[tile.nextTileIndex];
 			if (nextTile == nullptr)
 			{
-				std::fill(coverage.begin(), coverage.end(), 0.0f);
+				std::fill(carry.begin(), carry.end(), 0);
 			}
 		}
 	}
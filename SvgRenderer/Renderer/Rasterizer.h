@@ -9,24 +9,35 @@
 #include <glm/glm.hpp>
 
 #include <array>
-#include <mutex>
 
 namespace SvgRenderer {
 
-	struct PathRenderCmd;
-
 	class Rasterizer
 	{
 	public:
 		Rasterizer(uint32_t pathIndex);
 
 		void LineTo(const glm::vec2& last, const glm::vec2& p1);
+		// Turns the winding deltas recorded by LineTo() into the windings of the tiles, call after all the lines are filled
+		void ResolveBackdrops();
+		// Marks the screen tiles fully covered by the opaque spans of the path, call after ResolveBackdrops()
+		void MarkOccluders();
 
 		std::pair<uint32_t, uint32_t> CalculateNumberOfQuads();
 
 		void Coarse(TileBuilder& builder);
 		void Fine(TileBuilder& builder);
 	private:
+		// Returns increments index of the tile, allocating the increments on the first touch,
+		// or INVALID_INDEX if the increments pool is exhausted. Safe to call from multiple threads
+		uint32_t AcquireIncrements(Tile& tile);
+
+		// Returns true if an opaque path drawn later covers the whole screen tile
+		bool IsOccluded(int32_t tileX, int32_t tileY) const;
+		// Shrinks the span of screen tiles [firstTileX, lastTileX] from both sides while its tiles are occluded,
+		// returns false if nothing is left to draw
+		bool TrimOccludedSpan(int32_t& firstTileX, int32_t& lastTileX, int32_t tileY) const;
+
 		Tile& GetTileFromRelativePos(int32_t x, int32_t y) { return Globals::Tiles.tiles[Globals::AllPaths.paths[m_PathIndex].startTileIndex + GetTileIndexFromRelativePos(x, y)]; }
 		Tile& GetTileFromWindowPos(int32_t x, int32_t y) { return Globals::Tiles.tiles[Globals::AllPaths.paths[m_PathIndex].startTileIndex + GetTileIndexFromWindowPos(x, y)]; }
 
@@ -56,8 +67,6 @@ namespace SvgRenderer {
 		int32_t m_TileStartX, m_TileStartY;
 		uint32_t m_TileCountX, m_TileCountY;
 		uint32_t m_PathIndex;
-		std::mutex m_Mut1;
-		std::mutex m_Mut2;
 	};
 
 }
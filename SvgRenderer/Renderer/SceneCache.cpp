@@ -0,0 +1,262 @@
+#include "SceneCache.h"
+
+#include <cstring>
+
+namespace SvgRenderer {
+
+	struct SceneCacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t pathRenderSize; // Catches changes of PathRender, that were not followed by a new version
+		uint32_t pathCount;
+		uint64_t sourceSize;
+		uint64_t sourceHash;
+		uint32_t cmdCount;
+		uint32_t pointCount;
+	};
+
+	static constexpr char MAGIC[4] = { 'S', 'R', 'S', 'C' };
+
+	// Offsets of the arrays in the file, every array starts at a multiple of 16 bytes
+	struct SceneCacheLayout
+	{
+		size_t paths;
+		size_t cmdTypes;
+		size_t cmdPathIndices;
+		size_t cmdPointsOffsets;
+		size_t points;
+		size_t size;
+
+		static size_t Align(size_t offset) { return (offset + 15) / 16 * 16; }
+
+		static SceneCacheLayout Create(const SceneCacheHeader& header)
+		{
+			SceneCacheLayout layout;
+			layout.paths = Align(sizeof(SceneCacheHeader));
+			layout.cmdTypes = Align(layout.paths + static_cast<size_t>(header.pathCount) * sizeof(PathRender));
+			layout.cmdPathIndices = Align(layout.cmdTypes + GetPaddedTypesSize(header.cmdCount));
+			layout.cmdPointsOffsets = Align(layout.cmdPathIndices + static_cast<size_t>(header.cmdCount) * sizeof(uint32_t));
+			layout.points = Align(layout.cmdPointsOffsets + (static_cast<size_t>(header.cmdCount) + 1) * sizeof(uint32_t));
+			layout.size = layout.points + static_cast<size_t>(header.pointCount) * sizeof(glm::vec2);
+			return layout;
+		}
+
+		static size_t GetPaddedTypesSize(uint32_t cmdCount) { return (static_cast<size_t>(cmdCount) + 3) / 4 * 4; }
+	};
+
+	// FNV-1a over 8 byte words, it only has to notice that the SVG was edited, it is not a cryptographic hash
+	static uint64_t HashData(std::string_view data)
+	{
+		constexpr uint64_t prime = 1099511628211ull;
+
+		uint64_t hash = 14695981039346656037ull;
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= data.size(); i += sizeof(uint64_t))
+		{
+			uint64_t word;
+			std::memcpy(&word, data.data() + i, sizeof(uint64_t));
+			hash = (hash ^ word) * prime;
+		}
+
+		for (; i < data.size(); i++)
+		{
+			hash = (hash ^ static_cast<uint8_t>(data[i])) * prime;
+		}
+
+		return hash;
+	}
+
+	template<typename T>
+	static std::span<const T> GetArray(const MappedFile& file, size_t offset, size_t count)
+	{
+		return std::span<const T>(reinterpret_cast<const T*>(file.GetData() + offset), count);
+	}
+
+	// The pipelines and the shaders use the indices of the scene without any checks, so a damaged cache
+	// of the right size has to be caught here, otherwise it turns into reads out of bounds
+	static bool IsSceneValid(const SceneView& scene)
+	{
+		const uint32_t pathCount = static_cast<uint32_t>(scene.paths.size());
+		const uint32_t cmdCount = scene.GetCmdCount();
+		for (const PathRender& path : scene.paths)
+		{
+			if (path.startCmdIndex > path.endCmdIndex || path.endCmdIndex >= cmdCount)
+			{
+				return false;
+			}
+		}
+
+		// Points of the commands follow each other without gaps, as CommandsContainer::Add stores them
+		if (scene.cmdPointsOffsets[0] != 0 || scene.cmdPointsOffsets[cmdCount] != scene.points.size())
+		{
+			return false;
+		}
+
+		for (uint32_t i = 0; i < cmdCount; i++)
+		{
+			const uint32_t type = scene.cmdTypes[i];
+			if (type > CUBIC_TO || scene.cmdPointsOffsets[i + 1] - scene.cmdPointsOffsets[i] != GetCmdPointCount(type))
+			{
+				return false;
+			}
+
+			// The command has to be inside the range of its path, the previous point is looked up from it
+			const uint32_t pathIndex = scene.cmdPathIndices[i];
+			if (pathIndex >= pathCount || i < scene.paths[pathIndex].startCmdIndex || i > scene.paths[pathIndex].endCmdIndex)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool SceneCache::Open(const std::filesystem::path& svgPath)
+	{
+		m_File.Close();
+
+		std::error_code error;
+		if (!std::filesystem::exists(GetCachePath(svgPath), error))
+		{
+			return false;
+		}
+
+		MappedFile svgFile;
+		if (!svgFile.Open(svgPath) || !m_File.Open(GetCachePath(svgPath)))
+		{
+			m_File.Close();
+			return false;
+		}
+
+		SceneCacheHeader header;
+		if (m_File.GetSize() < sizeof(SceneCacheHeader))
+		{
+			SR_WARN("Scene cache is corrupted");
+			m_File.Close();
+			return false;
+		}
+
+		std::memcpy(&header, m_File.GetData(), sizeof(SceneCacheHeader));
+		if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.pathRenderSize != sizeof(PathRender))
+		{
+			SR_INFO("Scene cache is from a different version, it will be rebuilt");
+			m_File.Close();
+			return false;
+		}
+
+		const SceneCacheLayout layout = SceneCacheLayout::Create(header);
+		if (m_File.GetSize() != layout.size)
+		{
+			SR_WARN("Scene cache is corrupted");
+			m_File.Close();
+			return false;
+		}
+
+		if (header.sourceSize != svgFile.GetSize() || header.sourceHash != HashData(svgFile.GetView()))
+		{
+			SR_INFO("SVG changed since the scene cache was written, it will be rebuilt");
+			m_File.Close();
+			return false;
+		}
+
+		const SceneView view = SceneView{
+			.paths = GetArray<PathRender>(m_File, layout.paths, header.pathCount),
+			.cmdTypes = GetArray<uint8_t>(m_File, layout.cmdTypes, SceneCacheLayout::GetPaddedTypesSize(header.cmdCount)),
+			.cmdPathIndices = GetArray<uint32_t>(m_File, layout.cmdPathIndices, header.cmdCount),
+			.cmdPointsOffsets = GetArray<uint32_t>(m_File, layout.cmdPointsOffsets, header.cmdCount + 1),
+			.points = GetArray<glm::vec2>(m_File, layout.points, header.pointCount)
+		};
+
+		if (!IsSceneValid(view))
+		{
+			SR_WARN("Scene cache is corrupted, it will be rebuilt");
+			m_File.Close();
+			return false;
+		}
+
+		m_View = view;
+		return true;
+	}
+
+	void SceneCache::CopyTo(PathsContainer& scene) const
+	{
+		const uint32_t cmdCount = m_View.GetCmdCount();
+
+		scene.paths.assign(m_View.paths.begin(), m_View.paths.end());
+		scene.commands.Resize(cmdCount, static_cast<uint32_t>(m_View.points.size()));
+		std::copy_n(m_View.cmdTypes.begin(), cmdCount, scene.commands.types.begin());
+		std::copy(m_View.cmdPathIndices.begin(), m_View.cmdPathIndices.end(), scene.commands.pathIndices.begin());
+		std::copy(m_View.cmdPointsOffsets.begin(), m_View.cmdPointsOffsets.end(), scene.commands.pointsOffsets.begin());
+		std::copy(m_View.points.begin(), m_View.points.end(), scene.commands.points.begin());
+	}
+
+	bool SceneCache::Write(const std::filesystem::path& svgPath, std::string_view svgData, const PathsContainer& scene)
+	{
+		const CommandsContainer& commands = scene.commands;
+
+		SceneCacheHeader header;
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.pathRenderSize = sizeof(PathRender);
+		header.pathCount = static_cast<uint32_t>(scene.paths.size());
+		header.sourceSize = svgData.size();
+		header.sourceHash = HashData(svgData);
+		header.cmdCount = commands.Size();
+		header.pointCount = static_cast<uint32_t>(commands.points.size());
+
+		// Written under a temporary name first, so a run that is interrupted does not leave a broken cache behind
+		const std::filesystem::path cachePath = GetCachePath(svgPath);
+		std::filesystem::path tempPath = cachePath;
+		tempPath += ".tmp";
+
+		bool written = false;
+		{
+			std::ofstream file(tempPath, std::ios::binary);
+			if (!file)
+			{
+				return false;
+			}
+
+			size_t offset = 0;
+			auto writeArray = [&file, &offset](size_t arrayOffset, const void* data, size_t size)
+			{
+				static constexpr char zeros[16] = {};
+				file.write(zeros, arrayOffset - offset);
+				file.write(static_cast<const char*>(data), size);
+				offset = arrayOffset + size;
+			};
+
+			const SceneCacheLayout layout = SceneCacheLayout::Create(header);
+			std::vector<uint8_t> cmdTypes(commands.types.begin(), commands.types.end());
+			cmdTypes.resize(SceneCacheLayout::GetPaddedTypesSize(header.cmdCount));
+
+			writeArray(0, &header, sizeof(SceneCacheHeader));
+			writeArray(layout.paths, scene.paths.data(), scene.paths.size() * sizeof(PathRender));
+			writeArray(layout.cmdTypes, cmdTypes.data(), cmdTypes.size());
+			writeArray(layout.cmdPathIndices, commands.pathIndices.data(), commands.pathIndices.size() * sizeof(uint32_t));
+			writeArray(layout.cmdPointsOffsets, commands.pointsOffsets.data(), commands.pointsOffsets.size() * sizeof(uint32_t));
+			writeArray(layout.points, commands.points.data(), commands.points.size() * sizeof(glm::vec2));
+
+			written = file.good();
+		}
+
+		std::error_code error;
+		if (!written)
+		{
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+
+		std::filesystem::rename(tempPath, cachePath, error);
+		return !error;
+	}
+
+	std::filesystem::path SceneCache::GetCachePath(const std::filesystem::path& svgPath)
+	{
+		std::filesystem::path cachePath = svgPath;
+		cachePath += ".srcache";
+		return cachePath;
+	}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Core/MappedFile.h"
+
+#include "Renderer/Defs.h"
+
+#include <filesystem>
+#include <string_view>
+
+namespace SvgRenderer {
+
+	// Binary snapshot of the loaded scene, stored next to the SVG, so later runs do not have to parse it again.
+	// The cache is memory-mapped and its arrays are used in place, it is rejected if the SVG changed since
+	class SceneCache
+	{
+	public:
+		// Has to be increased whenever the layout of the file or of PathRender changes
+		static constexpr uint32_t VERSION = 2;
+	public:
+		// Maps the cache of the SVG, returns false if there is none, or if it does not match the SVG
+		bool Open(const std::filesystem::path& svgPath);
+		void Close() { m_File.Close(); }
+		bool IsOpen() const { return m_File.IsOpen(); }
+
+		// Paths and commands of the scene, the types are padded with zeros to whole uints
+		const SceneView& GetView() const { return m_View; }
+		// Copies the scene into the containers, for the CPU pipeline, which works on them in place
+		void CopyTo(PathsContainer& scene) const;
+
+		static bool Write(const std::filesystem::path& svgPath, std::string_view svgData, const PathsContainer& scene);
+		static std::filesystem::path GetCachePath(const std::filesystem::path& svgPath);
+	private:
+		MappedFile m_File;
+		SceneView m_View;
+	};
+
+}
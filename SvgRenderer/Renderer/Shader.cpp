@@ -27,6 +27,11 @@ namespace SvgRenderer {
 		glDispatchCompute(x, y, z);
 	}
 
+	void Shader::DispatchIndirect(size_t offset)
+	{
+		glDispatchComputeIndirect(static_cast<GLintptr>(offset));
+	}
+
 	void Shader::Bind() const
 	{
 		glUseProgram(m_RendererId);
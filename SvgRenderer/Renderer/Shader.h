@@ -13,6 +13,8 @@ namespace SvgRenderer {
 		~Shader();
 
 		void Dispatch(uint32_t x, uint32_t y, uint32_t z);
+		// Reads the group counts at the offset of the bound GL_DISPATCH_INDIRECT_BUFFER
+		void DispatchIndirect(size_t offset);
 
 		void Bind() const;
 
@@ -6,7 +6,7 @@
 
 namespace SvgRenderer {
 
-	void TileBuilder::Tile(int32_t x, int32_t y, const std::array<uint8_t, TILE_SIZE * TILE_SIZE>& data, uint32_t tileOffset, uint32_t quadIndex, const std::array<uint8_t, 4>& color)
+	void TileBuilder::Tile(int32_t x, int32_t y, uint32_t tileOffset, uint32_t quadIndex, const std::array<uint8_t, 4>& color)
 	{
 		size_t base = quadIndex * 4;
 
@@ -44,18 +44,15 @@ namespace SvgRenderer {
 			.uv = { u1, v2 },
 			.color = cc,
 			};
+	}
 
-		for (uint32_t y = 0; y < TILE_SIZE; ++y)
-		{
-			for (uint32_t x = 0; x < TILE_SIZE; ++x)
-			{
-				size_t index = row * TILE_SIZE * ATLAS_SIZE
-					+ y * ATLAS_SIZE
-					+ col * TILE_SIZE
-					+ x;
-				atlas[index] = data[y * TILE_SIZE + x] / 255.0f;
-			}
-		}
+	uint8_t* TileBuilder::GetAtlasTile(uint32_t tileOffset)
+	{
+		// The first slot is the full coverage one
+		tileOffset += 1;
+		const size_t col = tileOffset % (ATLAS_SIZE / TILE_SIZE);
+		const size_t row = tileOffset / (ATLAS_SIZE / TILE_SIZE);
+		return atlas.data() + row * TILE_SIZE * ATLAS_SIZE + col * TILE_SIZE;
 	}
 
 	void TileBuilder::Span(int32_t x, int32_t y, uint32_t width, uint32_t quadIndex, const std::array<uint8_t, 4>& color)
@@ -90,4 +87,69 @@ namespace SvgRenderer {
 			};
 	}
 
+	void TileBuilder::GenerateIndices(uint32_t quadCount)
+	{
+		indices.reserve(static_cast<size_t>(quadCount) * 6);
+
+		uint32_t vertexIndex = static_cast<uint32_t>(indices.size() / 6) * 4;
+		for (size_t i = indices.size(); i < static_cast<size_t>(quadCount) * 6; i += 6)
+		{
+			indices.push_back(vertexIndex + 0);
+			indices.push_back(vertexIndex + 1);
+			indices.push_back(vertexIndex + 2);
+			indices.push_back(vertexIndex + 0);
+			indices.push_back(vertexIndex + 2);
+			indices.push_back(vertexIndex + 3);
+			vertexIndex += 4;
+		}
+	}
+
+	void TileBuilder::Composite(uint32_t quadIndex, Image& target) const
+	{
+		const Vertex& topLeft = vertices[quadIndex * 4 + 0];
+		const Vertex& bottomRight = vertices[quadIndex * 4 + 2];
+
+		const int32_t width = bottomRight.pos.x - topLeft.pos.x;
+		const int32_t height = bottomRight.pos.y - topLeft.pos.y;
+		if (width <= 0 || height <= 0)
+		{
+			return;
+		}
+
+		const int32_t minX = glm::max(topLeft.pos.x, 0);
+		const int32_t minY = glm::max(topLeft.pos.y, 0);
+		const int32_t maxX = glm::min(bottomRight.pos.x, static_cast<int32_t>(target.GetWidth()));
+		const int32_t maxY = glm::min(bottomRight.pos.y, static_cast<int32_t>(target.GetHeight()));
+
+		// Spans have all uvs at the full coverage texel, tiles map 1:1 to the atlas
+		const uint32_t du = bottomRight.uv.x - topLeft.uv.x;
+		const uint32_t dv = bottomRight.uv.y - topLeft.uv.y;
+
+		const float r = topLeft.color.r;
+		const float g = topLeft.color.g;
+		const float b = topLeft.color.b;
+		const float alpha = topLeft.color.a / 255.0f;
+
+		for (int32_t y = minY; y < maxY; y++)
+		{
+			const uint32_t v = topLeft.uv.y + (y - topLeft.pos.y) * dv / height;
+			uint8_t* row = target.GetRow(y);
+			for (int32_t x = minX; x < maxX; x++)
+			{
+				const uint32_t u = topLeft.uv.x + (x - topLeft.pos.x) * du / width;
+				const float a = alpha * atlas[static_cast<size_t>(v) * ATLAS_SIZE + u] / 255.0f;
+				if (a <= 0.0f)
+				{
+					continue;
+				}
+
+				uint8_t* pixel = row + x * 4;
+				pixel[0] = static_cast<uint8_t>(r * a + pixel[0] * (1.0f - a) + 0.5f);
+				pixel[1] = static_cast<uint8_t>(g * a + pixel[1] * (1.0f - a) + 0.5f);
+				pixel[2] = static_cast<uint8_t>(b * a + pixel[2] * (1.0f - a) + 0.5f);
+				pixel[3] = static_cast<uint8_t>(255.0f * a + pixel[3] * (1.0f - a) + 0.5f);
+			}
+		}
+	}
+
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Renderer/Defs.h"
+#include "Renderer/Image.h"
 
 #include <array>
 #include <vector>
@@ -19,10 +20,20 @@ namespace SvgRenderer {
 	public:
 		std::vector<Vertex> vertices;
 		std::vector<uint32_t> indices;
-		std::vector<float> atlas;
+		std::vector<uint8_t> atlas; // Coverage, same as the GL_R8 texture it is uploaded to
 
-		void Tile(int32_t x, int32_t y, const std::array<uint8_t, TILE_SIZE * TILE_SIZE>& data, uint32_t tileOffset, uint32_t quadIndex, const std::array<uint8_t, 4>& color);
+		// The coverage of the tile is written by the rasterizer directly to GetAtlasTile(tileOffset)
+		void Tile(int32_t x, int32_t y, uint32_t tileOffset, uint32_t quadIndex, const std::array<uint8_t, 4>& color);
 		void Span(int32_t x, int32_t y, uint32_t width, uint32_t quadIndex, const std::array<uint8_t, 4>& color);
+
+		// Top left texel of the atlas slot of the tile, the rows of the slot are ATLAS_SIZE apart
+		uint8_t* GetAtlasTile(uint32_t tileOffset);
+
+		// Appends the indices of the quads up to quadCount, 4 vertices and 6 indices for 1 quad
+		void GenerateIndices(uint32_t quadCount);
+
+		// Blends the quad into the image the same way the final pass does on the GPU
+		void Composite(uint32_t quadIndex, Image& target) const;
 	};
 
 }
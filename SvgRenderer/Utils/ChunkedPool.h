@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+
+namespace SvgRenderer {
+
+	// Per-frame pool of value-initialized elements, that can be allocated from multiple threads at once.
+	// Elements live in fixed-size chunks, so they never move, and chunks are kept between frames,
+	// so after the first frames allocating is just an atomic increment.
+	template<typename T, uint32_t ChunkSize = 4096, uint32_t MaxChunks = 4096>
+	class ChunkedPool
+	{
+	public:
+		static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+		static constexpr uint32_t CAPACITY = ChunkSize * MaxChunks;
+	public:
+		ChunkedPool() = default;
+		~ChunkedPool()
+		{
+			for (std::atomic<T*>& chunk : m_Chunks)
+			{
+				delete[] chunk.load();
+			}
+		}
+
+		ChunkedPool(const ChunkedPool&) = delete;
+		ChunkedPool& operator=(const ChunkedPool&) = delete;
+
+		// Returns INVALID_INDEX if the pool is exhausted, the request is still counted by GetRequestedCount()
+		uint32_t Allocate()
+		{
+			const uint32_t index = m_Count.fetch_add(1, std::memory_order_relaxed);
+			const uint32_t chunkIndex = index / ChunkSize;
+			if (chunkIndex >= MaxChunks)
+			{
+				return INVALID_INDEX;
+			}
+
+			T* chunk = m_Chunks[chunkIndex].load(std::memory_order_acquire);
+			if (chunk == nullptr)
+			{
+				std::lock_guard lock(m_GrowMutex);
+				chunk = m_Chunks[chunkIndex].load(std::memory_order_relaxed);
+				if (chunk == nullptr)
+				{
+					chunk = new T[ChunkSize];
+					m_Chunks[chunkIndex].store(chunk, std::memory_order_release);
+				}
+			}
+
+			chunk[index % ChunkSize] = T{};
+			return index;
+		}
+
+		// Makes all the elements available again, memory is kept for the next frame
+		void Reset() { m_Count.store(0, std::memory_order_relaxed); }
+
+		// Allocated elements, at most CAPACITY
+		uint32_t GetCount() const { return std::min(GetRequestedCount(), CAPACITY); }
+		// Allocations since the last reset including the failed ones, past CAPACITY if the pool overflowed
+		uint32_t GetRequestedCount() const { return m_Count.load(std::memory_order_relaxed); }
+
+		T& operator[](uint32_t index) { return m_Chunks[index / ChunkSize].load(std::memory_order_relaxed)[index % ChunkSize]; }
+		const T& operator[](uint32_t index) const { return m_Chunks[index / ChunkSize].load(std::memory_order_relaxed)[index % ChunkSize]; }
+	private:
+		std::array<std::atomic<T*>, MaxChunks> m_Chunks{};
+		std::atomic_uint32_t m_Count = 0;
+		std::mutex m_GrowMutex;
+	};
+
+}